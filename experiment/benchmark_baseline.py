@@ -0,0 +1,238 @@
+# Performance regression gate. Runs the pinned benchmarks of
+# experiment/baseline_config.json and either records them as the baseline
+# or compares them with it:
+#
+#     python3 experiment/benchmark_baseline.py record
+#     python3 experiment/benchmark_baseline.py check
+#
+# The MPC benchmarks measure the time, rounds and data sent of party 0 in
+# every repetition, the native benchmarks the time that the C++ engine
+# reports for solving a pinned input.
+# check writes a diff report and exits with 1 if any metric got worse by
+# more than the threshold with a permutation test over the repetitions
+# finding the change significant.
+import argparse
+import itertools
+import json
+import logging
+import math
+import os
+import random
+import statistics
+import subprocess
+import sys
+import tempfile
+
+import run_experiment
+from results_db import ResultsDatabase
+
+# Metrics of party 0 compared for the MPC benchmarks
+mpc_metrics = ["time", "rounds", "data_sent_mb"]
+
+# Random permutations drawn when there are more distinct splits
+max_permutations = 10000
+
+
+def permutation_p_value(baseline: list, current: list) -> float:
+    """One-sided p-value of the current samples being larger than the
+    baseline samples, from the difference of their means."""
+
+    if statistics.pvariance(baseline) == 0 and statistics.pvariance(current) == 0:
+        # Deterministic metrics such as rounds, any increase is real
+        return 0.0 if statistics.mean(current) > statistics.mean(baseline) else 1.0
+
+    pooled = baseline + current
+    observed = statistics.mean(current) - statistics.mean(baseline)
+    n = len(current)
+    if math.comb(len(pooled), n) <= max_permutations:
+        splits = list(itertools.combinations(range(len(pooled)), n))
+    else:
+        splits = [random.sample(range(len(pooled)), n) for i in range(max_permutations)]
+
+    extreme = 0
+    for split in splits:
+        chosen = set(split)
+        sample = [pooled[i] for i in chosen]
+        rest = [pooled[i] for i in range(len(pooled)) if i not in chosen]
+        if statistics.mean(sample) - statistics.mean(rest) >= observed:
+            extreme += 1
+    return extreme / len(splits)
+
+
+def run_mpc_benchmark(exp: dict, repetitions: int) -> dict:
+    """Samples of every MPC metric over the repetitions of an experiment.
+    The benchmark has a fresh results database, so it is always measured."""
+
+    exp = dict(exp, repetitions=repetitions)
+    experiment = run_experiment.build_experiment(exp)
+    experiment.point = run_experiment.results_db.add_point(exp)
+    experiment.regular_run()
+
+    party_metrics = run_experiment.results_db.party_metrics(experiment.point, 0)
+    return {
+        metric: [party_metrics[i][metric] for i in range(repetitions)]
+        for metric in mpc_metrics
+        if all(party_metrics[i][metric] is not None for i in range(repetitions))
+    }
+
+
+def create_native_input(spec: dict, input_prefix: str) -> None:
+    """Writes <input_prefix>-P<party>-0 files in the format of the
+    harness, with items drawn from a generator seeded by the spec, so that
+    every run of the benchmark solves the same instances."""
+
+    generator = random.Random(spec["seed"])
+    for party in range(spec["n_parties"]):
+        lines = []
+        for instance in range(spec["instances"]):
+            weights = generator.choices(range(1, spec["max_weight"] + 1), k=spec["tx_per_party"])
+            values = generator.choices(range(spec["max_value"] + 1), k=spec["tx_per_party"])
+            lines.append(" ".join(map(str, values)))
+            lines.append(" ".join(map(str, weights)))
+        with open("{}-P{}-0".format(input_prefix, party), "w") as input_file:
+            input_file.write("\n".join(lines))
+
+
+def run_native_benchmark(native: dict, repetitions: int, build_path: str) -> dict:
+    """Samples of the time that the shifting knapsack CLI reports for
+    solving the pinned input of the benchmark in its mode. The program is
+    built with the flags of the benchmark."""
+
+    binary = os.path.join(build_path, native["name"])
+    subprocess.run(
+        ["g++"] + native.get("flags", ["-O2", "-std=c++17"]) + ["-o", binary, native["source"]],
+        check=True,
+    )
+
+    spec = native["input"]
+    input_prefix = os.path.join(build_path, native["name"] + "-Input")
+    create_native_input(spec, input_prefix)
+    command = [
+        binary,
+        native["mode"],
+        str(spec["max_weight"]),
+        str(spec["instances"]),
+        input_prefix,
+    ] + [str(spec["tx_per_party"])] * spec["n_parties"]
+
+    times = []
+    for i in range(repetitions):
+        native_result = subprocess.run(
+            command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, check=True
+        )
+        times.append(time_of(native_result.stderr.decode("utf-8")))
+    return {"time": times}
+
+
+def time_of(output: str) -> float:
+    """Seconds on the "Time = X seconds" line of a program output."""
+
+    for line in output.split("\n"):
+        if line.startswith("Time ="):
+            return float(line[len("Time =") :].split("seconds")[0])
+    raise ValueError("No time in the output")
+
+
+def run_benchmarks(benchmark_config: dict) -> dict:
+    """Samples of all pinned benchmarks, by benchmark name and metric."""
+
+    repetitions = benchmark_config["repetitions"]
+    samples = {}
+    with tempfile.TemporaryDirectory() as work_path:
+        run_experiment.results_db = ResultsDatabase(os.path.join(work_path, "results.sqlite"))
+        for exp in benchmark_config.get("experiments", []):
+            logging.info("Running benchmark {}".format(exp["name"]))
+            parameters = {name: value for name, value in exp.items() if name != "name"}
+            samples[exp["name"]] = run_mpc_benchmark(parameters, repetitions)
+        for native in benchmark_config.get("native", []):
+            logging.info("Running benchmark {}".format(native["name"]))
+            samples[native["name"]] = run_native_benchmark(native, repetitions, work_path)
+    return samples
+
+
+def compare(baseline: dict, current: dict, threshold: float, alpha: float) -> list:
+    """Comparison of every metric present in both sample sets, as rows of
+    (benchmark, metric, baseline median, current median, relative change,
+    p-value, status)."""
+
+    rows = []
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            status = "new" if name in current else "missing"
+            rows.append((name, "", None, None, None, None, status))
+            continue
+        for metric in sorted(set(baseline[name]) & set(current[name])):
+            before = statistics.median(baseline[name][metric])
+            after = statistics.median(current[name][metric])
+            change = (after - before) / before if before else 0.0
+            p_value = permutation_p_value(baseline[name][metric], current[name][metric])
+            if change > threshold and p_value <= alpha:
+                status = "REGRESSION"
+            elif change < -threshold and p_value >= 1 - alpha:
+                status = "improvement"
+            else:
+                status = "ok"
+            rows.append((name, metric, before, after, change, p_value, status))
+    return rows
+
+
+def format_report(rows: list, threshold: float, alpha: float) -> str:
+    """Markdown table of the comparison."""
+
+    lines = [
+        "# Benchmark comparison",
+        "",
+        "Threshold {:.0%}, significance level {}.".format(threshold, alpha),
+        "",
+        "| Benchmark | Metric | Baseline | Current | Change | p | Status |",
+        "|---|---|---|---|---|---|---|",
+    ]
+    for name, metric, before, after, change, p_value, status in rows:
+        if before is None:
+            lines.append("| {} | | | | | | {} |".format(name, status))
+            continue
+        lines.append(
+            "| {} | {} | {:.6g} | {:.6g} | {:+.1%} | {:.3f} | {} |".format(
+                name, metric, before, after, change, p_value, status
+            )
+        )
+    return "\n".join(lines) + "\n"
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Performance regression gate")
+    parser.add_argument("command", choices=["record", "check"])
+    parser.add_argument("--config", default="experiment/baseline_config.json")
+    parser.add_argument("--baseline", default="experiment/baselines/baseline.json")
+    parser.add_argument("--report", default="experiment/results/baseline_report.md")
+    args = parser.parse_args()
+
+    with open(args.config, "r") as benchmark_config_file:
+        benchmark_config = json.load(benchmark_config_file)
+
+    samples = run_benchmarks(benchmark_config)
+
+    if args.command == "record":
+        os.makedirs(os.path.dirname(args.baseline), exist_ok=True)
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(samples, baseline_file, indent=2)
+        logging.info("Baseline saved in {}".format(args.baseline))
+        sys.exit(0)
+
+    with open(args.baseline, "r") as baseline_file:
+        baseline = json.load(baseline_file)
+
+    threshold = benchmark_config.get("threshold", 0.1)
+    alpha = benchmark_config.get("alpha", 0.05)
+    rows = compare(baseline, samples, threshold, alpha)
+    report = format_report(rows, threshold, alpha)
+
+    os.makedirs(os.path.dirname(args.report), exist_ok=True)
+    with open(args.report, "w") as report_file:
+        report_file.write(report)
+    print(report)
+
+    regressions = [row for row in rows if row[6] == "REGRESSION"]
+    if regressions:
+        logging.error("{} metrics regressed".format(len(regressions)))
+        sys.exit(1)
@@ -0,0 +1,188 @@
+# Content-addressed cache of compiled MP-SPDZ programs. A compilation is
+# identified by everything that determines its output: the sources of the
+# program and of the shared modules in mpc_common, the compile.py flags and
+# arguments, and the MP-SPDZ version. The bytecode and the schedule are
+# kept per key, with the output of compile.py, and copied back into
+# MP-SPDZ/Programs instead of compiling again:
+#
+#     <key>/compile.out
+#     <key>/Programs/Schedules/<program>.sch
+#     <key>/Programs/Bytecode/<program>-<tape>.bc
+import hashlib
+import json
+import logging
+import os
+import re
+import shutil
+import subprocess
+from multiprocessing.pool import ThreadPool
+
+common_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "mpc_common")
+
+# Output of compile.py, at the top of an entry
+output_name = "compile.out"
+
+statistic_pattern = re.compile(r"^\s*(\d+)\s+(.+?)\s*$")
+edabits_pattern = re.compile(r"edaBits of length (\d+)")
+
+
+def compile_statistics(output: str) -> list:
+    """(count, description) lines after "Program requires" in the output of
+    compile.py."""
+
+    lines = output.split("\n")
+    for i, line in enumerate(lines):
+        if line.startswith("Program requires"):
+            break
+    else:
+        raise ValueError("No statistics in the compile.py output")
+
+    statistics = []
+    for line in lines[i + 1 :]:
+        match = statistic_pattern.match(line)
+        if not match:
+            break
+        statistics.append((int(match.group(1)), match.group(2)))
+    return statistics
+
+
+def largest_requirement(output: str) -> int:
+    """Largest number of items of one preprocessing type (triples, bits,
+    edaBits of one length, ...) in the output of compile.py."""
+
+    counts = [
+        count
+        for count, description in compile_statistics(output)
+        if description != "virtual machine rounds"
+    ]
+    return max(counts, default=0)
+
+
+def edabit_lengths(output: str) -> list:
+    """Distinct lengths of the edaBits in the output of compile.py."""
+
+    lengths = set()
+    for count, description in compile_statistics(output):
+        edabits = edabits_pattern.search(description)
+        if edabits:
+            lengths.add(int(edabits.group(1)))
+    return sorted(lengths)
+
+
+class CompileCache:
+    """Compiles programs through the cache at cache_path."""
+
+    def __init__(self, mp_spdz_root: str, cache_path: str) -> None:
+        self.mp_spdz_root = mp_spdz_root
+        self.cache_path = cache_path
+        self.version = self.mp_spdz_version()
+
+    def mp_spdz_version(self) -> str:
+        """Commit of the MP-SPDZ checkout, or a hash of its compiler sources
+        if it is not a git checkout."""
+
+        version_result = subprocess.run(
+            ["git", "rev-parse", "HEAD"],
+            cwd=self.mp_spdz_root,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+        )
+        if version_result.returncode == 0:
+            return version_result.stdout.decode("utf-8").strip()
+
+        digest = hashlib.sha256()
+        compiler_path = os.path.join(self.mp_spdz_root, "Compiler")
+        for name in sorted(os.listdir(compiler_path)):
+            if name.endswith(".py"):
+                with open(os.path.join(compiler_path, name), "rb") as source:
+                    digest.update(source.read())
+        return digest.hexdigest()
+
+    def key(self, mpc_file: str, flags: list, args: list) -> str:
+        """Hash of everything the output of compile.py depends on. mpc_file
+        is relative to the MP-SPDZ root, as compile.py gets it."""
+
+        digest = hashlib.sha256()
+        sources = [os.path.join(self.mp_spdz_root, mpc_file)] + sorted(
+            os.path.join(common_path, name)
+            for name in os.listdir(common_path)
+            if name.endswith(".py")
+        )
+        for path in sources:
+            digest.update(os.path.basename(path).encode("utf-8"))
+            with open(path, "rb") as source:
+                digest.update(source.read())
+        digest.update(json.dumps([flags, args, self.version]).encode("utf-8"))
+        return digest.hexdigest()
+
+    def program_files(self, program_name: str) -> list:
+        """Paths relative to the MP-SPDZ root of the compiled program: the
+        schedule and the bytecode of every tape. The third line of the
+        schedule names all tapes, those of functions and function blocks
+        included, in some MP-SPDZ versions followed by :<length>."""
+
+        schedule = os.path.join("Programs", "Schedules", program_name + ".sch")
+        with open(os.path.join(self.mp_spdz_root, schedule), "r") as schedule_file:
+            tapes = schedule_file.read().split("\n")[2].split()
+        return [schedule] + [
+            os.path.join("Programs", "Bytecode", tape.split(":")[0] + ".bc") for tape in tapes
+        ]
+
+    def compile(self, mpc_file: str, flags: list, args: list, program_name: str) -> None:
+        """Makes the compiled program available under program_name, from
+        the cache if it has been compiled before."""
+
+        entry = os.path.join(self.cache_path, self.key(mpc_file, flags, args))
+        if os.path.isdir(entry):
+            logging.info("Using cached compilation of {}".format(program_name))
+        else:
+            logging.info("Compiling MPC file {}".format(mpc_file))
+            compile_result = subprocess.run(
+                ["./compile.py"] + flags + [mpc_file] + args,
+                cwd=self.mp_spdz_root,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.STDOUT,
+            )
+            compile_result.check_returncode()
+
+            # Filled in a temporary directory first, so that an interrupted
+            # run never leaves a partial entry
+            partial_entry = entry + ".partial"
+            shutil.rmtree(partial_entry, ignore_errors=True)
+            for path in self.program_files(program_name):
+                os.makedirs(os.path.join(partial_entry, os.path.dirname(path)), exist_ok=True)
+                shutil.copy2(os.path.join(self.mp_spdz_root, path), os.path.join(partial_entry, path))
+            with open(os.path.join(partial_entry, output_name), "wb") as output_file:
+                output_file.write(compile_result.stdout)
+            os.rename(partial_entry, entry)
+
+        for directory, subdirectories, names in os.walk(os.path.join(entry, "Programs")):
+            for name in names:
+                path = os.path.relpath(os.path.join(directory, name), entry)
+                shutil.copy2(os.path.join(entry, path), os.path.join(self.mp_spdz_root, path))
+
+    def output(self, mpc_file: str, flags: list, args: list, program_name: str) -> str:
+        """Output of compile.py for the program, compiling it if needed."""
+
+        self.compile(mpc_file, flags, args, program_name)
+        entry = os.path.join(self.cache_path, self.key(mpc_file, flags, args))
+        with open(os.path.join(entry, output_name), "r") as output_file:
+            return output_file.read()
+
+    def precompile(self, jobs: list, n_workers: int) -> None:
+        """Compiles the (mpc_file, flags, args, program_name) jobs ahead of
+        time in parallel. Jobs that write the same program name run one
+        after the other, because compile.py writes to that name."""
+
+        groups = {}
+        for job in jobs:
+            groups.setdefault(job[3], []).append(job)
+
+        def compile_group(group):
+            for job in group:
+                self.compile(*job)
+
+        pool = ThreadPool(processes=n_workers)
+        pool.map(compile_group, list(groups.values()))
+        pool.close()
+        pool.join()
@@ -0,0 +1,321 @@
+# Analytical cost model of the MPC running time. The statistics that
+# compile.py prints for a program (triples, bits, edaBits, rounds) are
+# combined with the network of an experiment into a few features, and the
+# time is predicted as a non-negative linear combination of them:
+#
+#     time = fixed + sum of unit cost * preprocessing amount
+#            + transfer cost * total preprocessing amount / bandwidth
+#            + round cost * rounds * latency
+#
+# The unit costs are fitted per protocol from the repetitions in the results
+# database, after which any experiment entry can be predicted from its
+# compilation alone:
+#
+#     python3 experiment/cost_model.py calibrate
+#     python3 experiment/cost_model.py predict --slot 12
+#     python3 experiment/cost_model.py predict --experiment '{"algorithm": ...}'
+import argparse
+import json
+import logging
+import re
+import sqlite3
+import statistics
+import sys
+
+import run_experiment
+from compile_cache import compile_statistics, edabits_pattern
+from sweep import expand_config
+
+# Amounts of preprocessing that the features count, by the end of the
+# description in the compile.py statistics
+preprocessing_features = ["triples", "bits", "edabits", "bit_triples"]
+feature_names = ["fixed"] + preprocessing_features + ["transfer", "latency"]
+
+# Units of tc rates, in bytes per second, and of tc times, in seconds
+rate_units = {
+    "bit": 1 / 8,
+    "kbit": 1e3 / 8,
+    "mbit": 1e6 / 8,
+    "gbit": 1e9 / 8,
+    "tbit": 1e12 / 8,
+    "bps": 1,
+    "kbps": 1e3,
+    "mbps": 1e6,
+    "gbps": 1e9,
+    "tbps": 1e12,
+}
+time_units = {"s": 1, "sec": 1, "ms": 1e-3, "msec": 1e-3, "us": 1e-6, "usec": 1e-6}
+
+# Coefficients whose gradient is below this fraction of the largest one
+# count as optimal in the NNLS fit
+tolerance = 1e-10
+
+def parse_compile_statistics(output: str) -> dict:
+    """Amounts after "Program requires" in the output of compile.py, as
+    feature -> amount. edaBits count their bits."""
+
+    amounts = dict.fromkeys(preprocessing_features + ["rounds"], 0)
+    for count, description in compile_statistics(output):
+        edabits = edabits_pattern.search(description)
+        if edabits:
+            amounts["edabits"] += count * int(edabits.group(1))
+        elif description == "bit triples":
+            amounts["bit_triples"] += count
+        elif description.endswith("triples"):
+            amounts["triples"] += count
+        elif description.endswith("bits") or description.endswith("daBits"):
+            amounts["bits"] += count
+        elif description == "virtual machine rounds":
+            amounts["rounds"] += count
+    return amounts
+
+
+def parse_quantity(value: str, units: dict) -> float:
+    """Number of a tc quantity such as 10gbps or 0.3ms in the given units."""
+
+    match = re.fullmatch(r"([\d.]+)\s*([a-z]*)", value.strip().lower())
+    if not match or match.group(2) not in units:
+        raise ValueError("Cannot parse {}".format(value))
+    return float(match.group(1)) * units[match.group(2)]
+
+
+def network_of(exp: dict) -> tuple:
+    """Bandwidth in bytes per second (None if unlimited) and latency in
+    seconds of an experiment entry. With per-link shaping the slowest link
+    bounds every round."""
+
+    if "netns" in exp:
+        links = [exp["netns"].get("default", {})]
+        links += [dict(links[0], **link) for link in exp["netns"].get("links", [])]
+    elif exp.get("has_net_limit"):
+        links = [exp["net_limits"]]
+    else:
+        return None, 0.0
+
+    rates = [parse_quantity(link["bandwidth"], rate_units) for link in links if "bandwidth" in link]
+    latencies = [parse_quantity(link["latency"], time_units) for link in links if "latency" in link]
+    return (min(rates) if rates else None), (max(latencies) if latencies else 0.0)
+
+
+def model_name(exp: dict) -> str:
+    """Protocols are fitted separately, and so are online-only times."""
+
+    if exp.get("separate_offline"):
+        return exp["protocol"] + "-online"
+    return exp["protocol"]
+
+
+def features(exp: dict) -> list:
+    """Feature vector of an experiment entry, from its compilation."""
+
+    experiment = run_experiment.build_experiment(dict(exp, repetitions=1))
+    amounts = parse_compile_statistics(
+        run_experiment.compile_cache.output(*experiment.compile_job())
+    )
+    bandwidth, latency = network_of(exp)
+    total = sum(amounts[name] for name in preprocessing_features)
+    return (
+        [1.0]
+        + [float(amounts[name]) for name in preprocessing_features]
+        + [total / bandwidth if bandwidth else 0.0, amounts["rounds"] * latency]
+    )
+
+
+def solve(matrix: list, vector: list) -> list:
+    """Solution of a small square linear system by Gaussian elimination."""
+
+    n = len(vector)
+    rows = [matrix[i][:] + [vector[i]] for i in range(n)]
+    for column in range(n):
+        pivot = max(range(column, n), key=lambda row: abs(rows[row][column]))
+        rows[column], rows[pivot] = rows[pivot], rows[column]
+        for row in range(n):
+            if row != column and rows[column][column] != 0:
+                factor = rows[row][column] / rows[column][column]
+                rows[row] = [a - factor * b for a, b in zip(rows[row], rows[column])]
+    return [rows[i][n] / rows[i][i] if rows[i][i] != 0 else 0.0 for i in range(n)]
+
+
+def fit(samples: list) -> list:
+    """Non-negative least squares fit of (features, time) samples with the
+    active set method of Lawson and Hanson. The features are scaled to
+    comparable magnitudes first. A feature joins the fitted set only while
+    it reduces the residual, so a feature that is a multiple of a fitted one
+    never joins and the normal equations stay regular."""
+
+    n_features = len(samples[0][0])
+    scales = [max(abs(x[j]) for x, y in samples) or 1.0 for j in range(n_features)]
+    rows = [([x[j] / scales[j] for j in range(n_features)], y) for x, y in samples]
+
+    def gradient(solution):
+        residuals = [y - sum(a * c for a, c in zip(x, solution)) for x, y in rows]
+        return [sum(x[j] * r for (x, y), r in zip(rows, residuals)) for j in range(n_features)]
+
+    def least_squares(passive):
+        gram = [[sum(x[j] * x[k] for x, y in rows) for k in passive] for j in passive]
+        moments = [sum(x[j] * y for x, y in rows) for j in passive]
+        solution = [0.0] * n_features
+        for j, c in zip(passive, solve(gram, moments)):
+            solution[j] = c
+        return solution
+
+    solution = [0.0] * n_features
+    passive = []
+    w = gradient(solution)
+    threshold = tolerance * max(max(abs(value) for value in w), 1.0)
+    for iteration in range(3 * n_features):
+        zero = [j for j in range(n_features) if j not in passive]
+        if not zero or max(w[j] for j in zero) <= threshold:
+            break
+        passive.append(max(zero, key=lambda j: w[j]))
+
+        while True:
+            candidate = least_squares(passive)
+            if all(candidate[j] > 0 for j in passive):
+                solution = candidate
+                break
+            # Move towards the candidate until the first coefficient reaches
+            # zero, and drop the coefficients that did
+            step = min(
+                solution[j] / (solution[j] - candidate[j])
+                for j in passive
+                if candidate[j] <= 0
+            )
+            solution = [a + step * (b - a) for a, b in zip(solution, candidate)]
+            passive = [j for j in passive if solution[j] > threshold]
+            solution = [c if j in passive else 0.0 for j, c in enumerate(solution)]
+        w = gradient(solution)
+
+    return [c / scale for c, scale in zip(solution, scales)]
+
+
+def predict(coefficients: list, x: list) -> float:
+    return sum(c * value for c, value in zip(coefficients, x))
+
+
+def calibration_samples(db_path: str) -> dict:
+    """(features, time) samples per model and point from the measured
+    repetitions, as model -> point parameters -> samples."""
+
+    connection = sqlite3.connect(db_path)
+    rows = connection.execute(
+        "SELECT parameters, time FROM points JOIN repetitions USING (point)"
+    )
+    samples = {}
+    features_cache = {}
+    for parameters, time in rows:
+        exp = json.loads(parameters)
+        if parameters not in features_cache:
+            features_cache[parameters] = features(exp)
+        points = samples.setdefault(model_name(exp), {})
+        points.setdefault(parameters, []).append((features_cache[parameters], time))
+    return samples
+
+
+def relative_errors(coefficients: list, samples: list) -> list:
+    return [abs(predict(coefficients, x) - y) / y for x, y in samples if y > 0]
+
+
+def calibrate(db_path: str) -> dict:
+    """Fitted model per protocol. The held-out error predicts each point
+    with a model fitted to the other points of the protocol, which is how
+    far off the prediction of a new experiment can be expected to be; the
+    training error only shows how well the samples themselves fit."""
+
+    models = {}
+    for name, points in calibration_samples(db_path).items():
+        samples = [sample for point_samples in points.values() for sample in point_samples]
+        coefficients = fit(samples)
+        training_errors = relative_errors(coefficients, samples)
+
+        held_out_errors = []
+        if len(points) > 1:
+            for parameters, point_samples in points.items():
+                others = [
+                    sample
+                    for other, other_samples in points.items()
+                    if other != parameters
+                    for sample in other_samples
+                ]
+                held_out_errors += relative_errors(fit(others), point_samples)
+
+        models[name] = {
+            "coefficients": dict(zip(feature_names, coefficients)),
+            "samples": len(samples),
+            "points": len(points),
+            "training_relative_error": statistics.mean(training_errors) if training_errors else None,
+            "held_out_relative_error": statistics.mean(held_out_errors) if held_out_errors else None,
+        }
+        logging.info(
+            "Calibrated {} from {} samples of {} points, mean relative error {} on the samples, {} on held-out points".format(
+                name,
+                len(samples),
+                len(points),
+                models[name]["training_relative_error"],
+                models[name]["held_out_relative_error"],
+            )
+        )
+    return models
+
+
+def predict_experiment(models: dict, exp: dict) -> float:
+    """Predicted running time of an experiment entry in seconds."""
+
+    name = model_name(exp)
+    if name not in models:
+        raise ValueError("No calibration for protocol {}".format(name))
+    coefficients = [models[name]["coefficients"][feature] for feature in feature_names]
+    return predict(coefficients, features(exp))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="MPC running time cost model")
+    parser.add_argument("command", choices=["calibrate", "predict"])
+    parser.add_argument(
+        "--db", default=run_experiment.config.get("results_db_path", "experiment/results/results.sqlite")
+    )
+    parser.add_argument("--model", default="experiment/cost_model.json")
+    parser.add_argument("--config", default="experiment/config.json")
+    parser.add_argument("--experiment", help="experiment entry in JSON, instead of the config")
+    parser.add_argument("--slot", type=float, help="time budget in seconds to check against")
+    args = parser.parse_args()
+
+    if args.command == "calibrate":
+        models = calibrate(args.db)
+        with open(args.model, "w") as model_file:
+            json.dump(models, model_file, indent=2)
+        logging.info("Cost model saved in {}".format(args.model))
+        sys.exit(0)
+
+    with open(args.model, "r") as model_file:
+        models = json.load(model_file)
+
+    if args.experiment is not None:
+        entries = [json.loads(args.experiment)]
+    else:
+        with open(args.config, "r") as config_file:
+            entries = expand_config(json.load(config_file))
+
+    exceeded = False
+    for exp in entries:
+        predicted = predict_experiment(models, exp)
+        line = "{:10.3f} s  {} {} W={} N={} tx={} network={}".format(
+            predicted,
+            exp["algorithm"],
+            exp["protocol"],
+            exp["max_weight"],
+            exp["n_parties"],
+            exp["tx_per_party"],
+            json.dumps(network_of(exp)),
+        )
+        if args.slot is not None:
+            fits = predicted <= args.slot
+            exceeded = exceeded or not fits
+            line += "  {}".format("fits" if fits else "exceeds slot")
+            held_out_error = models[model_name(exp)].get("held_out_relative_error")
+            if held_out_error is not None:
+                line += " (held-out error {:.0%})".format(held_out_error)
+        print(line)
+
+    if exceeded:
+        sys.exit(1)
@@ -0,0 +1,124 @@
+# Structured metrics of the parties of an MPC run: the statistics that
+# every MP-SPDZ party prints and the resource usage of its process. Rows
+# are appended to a JSON lines file and a CSV file, one row per party and
+# repetition, keyed by the experiment parameters.
+import csv
+import json
+import logging
+import os
+import re
+
+# Statistics lines of the MP-SPDZ virtual machines
+time_pattern = re.compile(r"^Time = ([\d.e+-]+) seconds", re.M)
+data_pattern = re.compile(r"^Data sent = ([\d.e+-]+) MB in ~(\d+) rounds", re.M)
+global_data_pattern = re.compile(r"^Global data sent = ([\d.e+-]+) MB", re.M)
+phases_pattern = re.compile(
+    r"^Spent ([\d.e+-]+) seconds \(([\d.e+-]+) MB, (\d+) rounds\) on the online phase"
+    r" and ([\d.e+-]+) seconds \(([\d.e+-]+) MB, (\d+) rounds\) on the"
+    r" preprocessing/offline phase",
+    re.M,
+)
+
+# Columns of the CSV file, parameters first. point is the key of the
+# experiment in the results database, and network the JSON of its
+# net_limits or netns settings.
+key_columns = [
+    "date",
+    "point",
+    "algorithm",
+    "protocol",
+    "max_weight",
+    "max_value",
+    "n_parties",
+    "tx_per_party",
+    "weight_bound",
+    "tx_bound",
+    "value_bound",
+    "instances",
+    "incremental",
+    "separate_offline",
+    "network",
+    "repetition",
+    "party",
+]
+metric_columns = [
+    "time",
+    "data_sent_mb",
+    "rounds",
+    "global_data_sent_mb",
+    "online_time",
+    "online_data_mb",
+    "online_rounds",
+    "offline_time",
+    "offline_data_mb",
+    "offline_rounds",
+    "wall_time",
+    "user_cpu_time",
+    "system_cpu_time",
+    "peak_rss_kb",
+]
+
+
+def parse_party_output(output: str) -> dict:
+    """Statistics printed by one party. Statistics that the protocol does
+    not print are None."""
+
+    metrics = dict.fromkeys(metric_columns)
+    match = time_pattern.search(output)
+    if match:
+        metrics["time"] = float(match.group(1))
+    match = data_pattern.search(output)
+    if match:
+        metrics["data_sent_mb"] = float(match.group(1))
+        metrics["rounds"] = int(match.group(2))
+    match = global_data_pattern.search(output)
+    if match:
+        metrics["global_data_sent_mb"] = float(match.group(1))
+    match = phases_pattern.search(output)
+    if match:
+        metrics["online_time"] = float(match.group(1))
+        metrics["online_data_mb"] = float(match.group(2))
+        metrics["online_rounds"] = int(match.group(3))
+        metrics["offline_time"] = float(match.group(4))
+        metrics["offline_data_mb"] = float(match.group(5))
+        metrics["offline_rounds"] = int(match.group(6))
+    return metrics
+
+
+def resource_metrics(rusage, wall_time: float) -> dict:
+    """Resource usage of a finished party process, from os.wait4."""
+
+    return {
+        "wall_time": wall_time,
+        "user_cpu_time": rusage.ru_utime,
+        "system_cpu_time": rusage.ru_stime,
+        # ru_maxrss is in kilobytes on Linux
+        "peak_rss_kb": rusage.ru_maxrss,
+    }
+
+
+def save_rows(rows: list, results_path: str) -> None:
+    """Appends rows to metrics.jsonl and metrics.csv in results_path."""
+
+    os.makedirs(results_path, exist_ok=True)
+    with open(os.path.join(results_path, "metrics.jsonl"), "a") as json_file:
+        for row in rows:
+            json_file.write(json.dumps(row) + "\n")
+
+    path_csv = os.path.join(results_path, "metrics.csv")
+    write_header = not os.path.exists(path_csv)
+    if not write_header:
+        with open(path_csv, "r", newline="") as csv_file:
+            header = next(csv.reader(csv_file), [])
+        # Rows with other columns would not line up with the header
+        if header != key_columns + metric_columns:
+            logging.warning("Moving {} with older columns to {}.old".format(path_csv, path_csv))
+            os.replace(path_csv, path_csv + ".old")
+            write_header = True
+    with open(path_csv, "a", newline="") as csv_file:
+        writer = csv.DictWriter(
+            csv_file, fieldnames=key_columns + metric_columns, extrasaction="ignore"
+        )
+        if write_header:
+            writer.writeheader()
+        writer.writerows(rows)
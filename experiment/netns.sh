@@ -0,0 +1,98 @@
+#!/bin/bash
+#
+#  netns.sh
+#  --------
+#  Emulates a network of MPC parties on a single machine. Every party gets
+#  its own network namespace mpc-p<i> with the address 10.77.0.<i+1>, and
+#  every pair of parties is connected by its own veth pair, so that each
+#  direction of each link can be shaped separately with tc.
+#
+#  Usage
+#  -----
+#  netns.sh start <parties> - creates the namespaces and the links
+#  netns.sh shape <from> <to> <rate> <latency> <jitter> <loss> - shapes the
+#      traffic from party <from> to party <to>
+#  netns.sh stop <parties> - deletes the namespaces and with them the links
+#  netns.sh show <parties> - shows the rules of every link
+#
+#  Rates, delays and losses use the units of tc, for example 100mbit, 40ms
+#  and 0.1%.
+
+set -e
+
+address() {
+    echo 10.77.0.$(($1 + 1))
+}
+
+start() {
+    for i in $(seq 0 $(($1 - 1))); do
+        ip netns add mpc-p$i
+        ip -n mpc-p$i link set lo up
+        ip -n mpc-p$i addr add $(address $i)/32 dev lo
+    done
+
+    for i in $(seq 0 $(($1 - 1))); do
+        for j in $(seq $((i + 1)) $(($1 - 1))); do
+            ip link add p$i-p$j netns mpc-p$i type veth peer name p$j-p$i netns mpc-p$j
+            ip -n mpc-p$i link set p$i-p$j up
+            ip -n mpc-p$j link set p$j-p$i up
+            ip -n mpc-p$i route add $(address $j)/32 dev p$i-p$j src $(address $i)
+            ip -n mpc-p$j route add $(address $i)/32 dev p$j-p$i src $(address $j)
+        done
+    done
+}
+
+shape() {
+    NS=mpc-p$1
+    DEV=p$1-p$2
+    ip netns exec $NS tc qdisc add dev $DEV root handle 1: htb default 12
+    ip netns exec $NS tc class add dev $DEV parent 1: classid 1:12 htb rate $3 ceil $3
+    ip netns exec $NS tc qdisc add dev $DEV parent 1:12 netem delay $4 $5 loss $6
+}
+
+stop() {
+    for i in $(seq 0 $(($1 - 1))); do
+        ip netns del mpc-p$i
+    done
+}
+
+show() {
+    for i in $(seq 0 $(($1 - 1))); do
+        echo "Links of party $i:"
+        ip netns exec mpc-p$i tc -s qdisc ls
+    done
+}
+
+case "$1" in
+
+start)
+
+echo -n "Creating namespaces for $2 parties: "
+start $2
+echo "done"
+;;
+
+shape)
+
+shape $2 $3 $4 $5 $6 $7
+;;
+
+stop)
+
+echo -n "Deleting namespaces of $2 parties: "
+stop $2
+echo "done"
+;;
+
+show)
+
+show $2
+;;
+
+*)
+
+echo "Usage: netns.sh {start|shape|stop|show}"
+;;
+
+esac
+exit 0
@@ -0,0 +1,154 @@
+# SQLite database of measured repetitions, which lets an interrupted run of
+# the harness resume. A point is one experiment entry identified by its
+# measurement parameters; every repetition is committed as soon as it has
+# run, and the repetitions a point already has are not run again.
+import hashlib
+import json
+import os
+import sqlite3
+from datetime import datetime
+
+# Fields of an experiment entry that do not change what is measured
+unkeyed_fields = ["repetitions", "in_parallel"]
+
+schema = """
+CREATE TABLE IF NOT EXISTS points (
+    point TEXT PRIMARY KEY,
+    parameters TEXT NOT NULL
+);
+CREATE TABLE IF NOT EXISTS repetitions (
+    point TEXT NOT NULL REFERENCES points (point),
+    repetition INTEGER NOT NULL,
+    date TEXT NOT NULL,
+    time REAL NOT NULL,
+    outputs TEXT NOT NULL,
+    PRIMARY KEY (point, repetition)
+);
+CREATE TABLE IF NOT EXISTS offline_phases (
+    point TEXT PRIMARY KEY REFERENCES points (point),
+    date TEXT NOT NULL,
+    time REAL NOT NULL
+);
+CREATE TABLE IF NOT EXISTS native_runs (
+    point TEXT NOT NULL REFERENCES points (point),
+    repetition INTEGER NOT NULL,
+    mode TEXT NOT NULL,
+    time REAL NOT NULL,
+    correct INTEGER NOT NULL,
+    PRIMARY KEY (point, repetition, mode)
+);
+CREATE TABLE IF NOT EXISTS party_metrics (
+    point TEXT NOT NULL REFERENCES points (point),
+    repetition INTEGER NOT NULL,
+    party INTEGER NOT NULL,
+    metrics TEXT NOT NULL,
+    PRIMARY KEY (point, repetition, party)
+);
+"""
+
+
+def point_key(exp: dict) -> str:
+    """Identifier of the point of an experiment entry."""
+
+    parameters = {name: value for name, value in exp.items() if name not in unkeyed_fields}
+    return hashlib.sha256(json.dumps(parameters, sort_keys=True).encode("utf-8")).hexdigest()
+
+
+class ResultsDatabase:
+    """Repetitions and party metrics stored at path."""
+
+    def __init__(self, path: str) -> None:
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self.connection = sqlite3.connect(path)
+        self.connection.executescript(schema)
+
+    def add_point(self, exp: dict) -> str:
+        """Registers the point of an experiment entry and returns its key."""
+
+        key = point_key(exp)
+        parameters = {name: value for name, value in exp.items() if name not in unkeyed_fields}
+        with self.connection:
+            self.connection.execute(
+                "INSERT OR IGNORE INTO points VALUES (?, ?)",
+                (key, json.dumps(parameters, sort_keys=True)),
+            )
+        return key
+
+    def repetitions(self, key: str) -> dict:
+        """Measured repetitions of a point, as repetition -> (time, outputs)."""
+
+        rows = self.connection.execute(
+            "SELECT repetition, time, outputs FROM repetitions WHERE point = ?", (key,)
+        )
+        return {repetition: (time, json.loads(outputs)) for repetition, time, outputs in rows}
+
+    def save_repetition(self, key: str, repetition: int, time: float, outputs: dict, rows: list) -> None:
+        """Stores one repetition and the metrics of its parties in one
+        transaction."""
+
+        with self.connection:
+            self.connection.execute(
+                "INSERT OR REPLACE INTO repetitions VALUES (?, ?, ?, ?, ?)",
+                (key, repetition, str(datetime.now()), time, json.dumps(outputs)),
+            )
+            self.connection.executemany(
+                "INSERT OR REPLACE INTO party_metrics VALUES (?, ?, ?, ?)",
+                [(key, repetition, row["party"], json.dumps(row)) for row in rows],
+            )
+
+    def party_metrics(self, key: str, party: int) -> dict:
+        """Metrics of one party in every measured repetition of a point, as
+        repetition -> metrics row."""
+
+        rows = self.connection.execute(
+            "SELECT repetition, metrics FROM party_metrics WHERE point = ? AND party = ?",
+            (key, party),
+        )
+        return {repetition: json.loads(metrics) for repetition, metrics in rows}
+
+    def save_offline_time(self, key: str, time: float) -> None:
+        """Stores the time of the latest offline phase of a point."""
+
+        with self.connection:
+            self.connection.execute(
+                "INSERT OR REPLACE INTO offline_phases VALUES (?, ?, ?)",
+                (key, str(datetime.now()), time),
+            )
+
+    def offline_time(self, key: str):
+        """Time of the latest offline phase of a point, or None."""
+
+        row = self.connection.execute(
+            "SELECT time FROM offline_phases WHERE point = ?", (key,)
+        ).fetchone()
+        return row[0] if row else None
+
+    def save_native_run(self, key: str, repetition: int, mode: str, time: float, correct: bool) -> None:
+        """Stores a run of the native baseline on the inputs of a repetition."""
+
+        with self.connection:
+            self.connection.execute(
+                "INSERT OR REPLACE INTO native_runs VALUES (?, ?, ?, ?, ?)",
+                (key, repetition, mode, time, int(correct)),
+            )
+
+    def native_runs(self, key: str) -> dict:
+        """Native baseline runs of a point, as mode -> list of (time,
+        whether its values agreed with the MPC program)."""
+
+        rows = self.connection.execute(
+            "SELECT mode, time, correct FROM native_runs WHERE point = ? ORDER BY repetition",
+            (key,),
+        )
+        runs = {}
+        for mode, time, correct in rows:
+            runs.setdefault(mode, []).append((time, bool(correct)))
+        return runs
+
+    def clear(self, key: str) -> None:
+        """Drops the repetitions of a point, which then runs from scratch."""
+
+        with self.connection:
+            self.connection.execute("DELETE FROM repetitions WHERE point = ?", (key,))
+            self.connection.execute("DELETE FROM party_metrics WHERE point = ?", (key,))
+            self.connection.execute("DELETE FROM native_runs WHERE point = ?", (key,))
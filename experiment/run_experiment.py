@@ -1,13 +1,24 @@
 import json
 import logging
+import math
 from datetime import datetime
 import subprocess
 import random
 import os.path
 import os
+import sys
 import multiprocessing
+import socket
+import tempfile
 import time as delay
 
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "mpc_common"))
+from bit_lengths import domain_size, knapsack_bit_lengths, padded_length
+from compile_cache import CompileCache, edabit_lengths, largest_requirement
+import metrics
+from results_db import ResultsDatabase
+from sweep import expand_config
+
 # Setup logging
 logging.basicConfig(
     format="%(asctime)s - %(levelname)s - %(message)s", level=logging.INFO
@@ -17,6 +28,14 @@ logging.basicConfig(
 with open("experiment/config.json", "r") as config_file:
     config = json.load(config_file)
 
+compile_cache = CompileCache(
+    config["mp_spdz_root"], config.get("compile_cache_path", "experiment/compile_cache")
+)
+
+results_db = ResultsDatabase(
+    config.get("results_db_path", "experiment/results/results.sqlite")
+)
+
 ring_protocols = [
     "semi2k.sh",
     "spdz2k.sh",
@@ -27,6 +46,81 @@ ring_protocols = [
 
 field_protocols = ["shamir.sh" "mascot.sh" "mal-shamir.sh", "semi.sh", "sy-shamir.sh"]
 
+# Party binaries behind the MP-SPDZ scripts, for runs that start every
+# party separately
+protocol_binaries = {
+    "semi2k.sh": "semi2k-party.x",
+    "spdz2k.sh": "spdz2k-party.x",
+    "rep4-ring.sh": "rep4-ring-party.x",
+    "sy-rep-ring.sh": "sy-rep-ring-party.x",
+    "mal-rep-ring.sh": "malicious-rep-ring-party.x",
+    "shamir.sh": "shamir-party.x",
+    "mascot.sh": "mascot-party.x",
+    "mal-shamir.sh": "malicious-shamir-party.x",
+    "semi.sh": "semi-party.x",
+    "sy-shamir.sh": "sy-shamir-party.x",
+}
+
+# Protocols for a fixed number of parties, whose binaries take no -N
+fixed_party_protocols = ["rep4-ring.sh", "sy-rep-ring.sh", "mal-rep-ring.sh"]
+
+# Programs that can solve several independent instances in one run
+multi_instance_algorithms = [
+    "mpc_block_knapsack/knapsack.mpc",
+    "mpc_shifting_knapsack/shifting_knapsack.mpc",
+]
+
+# Programs that sort their items in a network of power-of-two length and
+# sum over the padding rows
+padded_algorithms = ["mpc_knapsack_auction/knapsack_auction.mpc"]
+
+# Programs that can keep their state between runs
+incremental_algorithms = ["mpc_shifting_knapsack/shifting_knapsack.mpc"]
+
+# Programs that compute the exact knapsack value, which the native C++
+# shifting knapsack computes as well
+native_algorithms = [
+    "mpc_block_knapsack/knapsack.mpc",
+    "mpc_shifting_knapsack/shifting_knapsack.mpc",
+]
+native_source = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "mpc_shifting_knapsack", "shifting_knapsack.cpp"
+)
+native_modes = ["plain", "oblivious"]
+
+
+def init_worker(counter) -> None:
+    """Gives every process of a parallel run a distinct slot, which selects
+    the cores its parties run on."""
+
+    global worker_slot
+    with counter.get_lock():
+        worker_slot = counter.value
+        counter.value += 1
+
+
+def free_port_base(first_port: int, n_ports: int, attempts: int = 100) -> int:
+    """First of the port ranges first_port, first_port + n_ports, ... whose
+    ports can all be bound. Ports of a finished run may still be held by
+    connections in TIME_WAIT, so the next run moves on to a free range
+    instead of waiting for them."""
+
+    for attempt in range(attempts):
+        port_base = first_port + attempt * n_ports
+        sockets = []
+        try:
+            for port in range(port_base, port_base + n_ports):
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sockets.append(sock)
+                sock.bind(("", port))
+            return port_base
+        except OSError:
+            continue
+        finally:
+            for sock in sockets:
+                sock.close()
+    raise RuntimeError("No free range of {} ports from {}".format(n_ports, first_port))
+
 
 class Experiment:
     """Class that represents an experiment"""
@@ -41,6 +135,14 @@ class Experiment:
         n_parties: int,
         repetitions: int,
         net_controller=None,
+        weight_bound=None,
+        tx_bound=None,
+        value_bound=None,
+        instances=1,
+        incremental=False,
+        separate_offline=False,
+        native_baseline=False,
+        network=None,
     ) -> None:
         self.algorithm = algorithm
         self.protocol = protocol
@@ -48,52 +150,288 @@ class Experiment:
         self.max_value = max_value
         self.n_parties = n_parties
         self.tx_per_party = tx_per_party
+        # tx_per_party is either one count for every party or a list with
+        # the count of each party
+        if isinstance(tx_per_party, list):
+            self.tx_counts = tx_per_party
+        else:
+            self.tx_counts = [tx_per_party] * n_parties
         self.net_controller = net_controller
+        # net_limits or netns settings of the entry, None without shaping
+        self.network = network
         self.has_finished = False
         self.repetitions = repetitions
         self.result = None
 
+        # The programs are compiled for these upper bounds and receive the
+        # actual capacity and transaction count as public runtime inputs.
+        self.weight_bound = weight_bound if weight_bound is not None else max_weight
+        self.tx_bound = tx_bound if tx_bound is not None else max(self.tx_counts)
+        self.value_bound = value_bound if value_bound is not None else max_value
+
+        # Number of independent instances solved per run, each with its own
+        # items, as lanes of the same program
+        if instances > 1 and algorithm not in multi_instance_algorithms:
+            raise ValueError("{} solves a single instance".format(algorithm))
+        self.instances = instances
+
+        # In incremental mode every repetition folds the newly generated
+        # items into the state left by the previous one, so the repetitions
+        # measure the latency per arrival of tx_per_party items
+        if incremental and algorithm not in incremental_algorithms:
+            raise ValueError("{} has no incremental mode".format(algorithm))
+        self.incremental = incremental
+
+        # Set for parallel runs, whose repetitions get their own workspace,
+        # ports and cores
+        self.isolated = False
+        self.cores_per_repetition = 1
+
+        # Key of the experiment in the results database
+        self.point = None
+
+        # With a separate offline phase, the preprocessing is generated into
+        # Player-Data once and every repetition only runs the online phase
+        # on it, so that the repetition times are online times
+        self.separate_offline = separate_offline
+        self.offline_time = None
+
+        # With the native baseline, the C++ shifting knapsack solves the
+        # inputs of every repetition as well, and its results are checked
+        # against those of the MPC program. An incremental program solves
+        # the items of all repetitions so far, which the inputs do not hold.
+        if native_baseline and (algorithm not in native_algorithms or incremental):
+            raise ValueError("{} has no native baseline".format(algorithm))
+        self.native_baseline = native_baseline
+
     def parallel_run(self):
         """Runs the experiment with the specified parameters."""
-        num_processes = multiprocessing.cpu_count() // 2
-        pool = multiprocessing.Pool(processes=num_processes)
+        if self.incremental:
+            raise ValueError("Incremental repetitions depend on each other")
+
+        missing = self.missing_repetitions()
+        if missing:
+            self.compile_mpc_file()
+            self.setup_ssl()
+            if self.separate_offline:
+                self.run_offline_phase()
+            if self.native_baseline:
+                self.build_native_binary()
+
+            # The public inputs are the same in every repetition, so they are
+            # written once before any party reads them
+            self.create_public_input_file(0)
+
+            num_processes = max(1, multiprocessing.cpu_count() // 2)
+            self.isolated = True
+            self.cores_per_repetition = max(1, multiprocessing.cpu_count() // num_processes)
+            pool = multiprocessing.Pool(
+                processes=num_processes,
+                initializer=init_worker,
+                initargs=(multiprocessing.Value("i", 0),),
+            )
 
-        self.times = pool.map(self.run_repetition, range(repetitions))
+            # The shaper applies to the whole loopback interface, so all
+            # repetitions run under one shaper instead of toggling it
+            if self.net_controller is not None:
+                self.net_controller.start()
 
-        pool.close()
-        pool.join()
+            # Recorded by this process only, the workers share no database.
+            # Each repetition is stored as soon as it finishes, so that an
+            # interruption loses only the ones still running.
+            for repetition, repetition_result in pool.imap_unordered(
+                self.numbered_repetition, missing
+            ):
+                self.record_repetition(repetition, *repetition_result)
 
-        self.average_time = sum(self.times) / len(self.times)
-        self.save_general_results_file()
+            pool.close()
+            pool.join()
+
+            if self.net_controller is not None:
+                self.net_controller.stop()
+
+        self.summarize()
 
     def regular_run(self) -> None:
-        self.times = []
-        for i in range(repetitions):
-            self.times.append(self.run_repetition(i))
-            delay.sleep(30)  # Sleep the execution for some seconds
+        # An incremental run builds on the state of its previous
+        # repetitions, which an interruption lost, so it starts over
+        if self.incremental and self.missing_repetitions():
+            results_db.clear(self.point)
+
+        missing = self.missing_repetitions()
+        if missing:
+            self.compile_mpc_file()
+            self.setup_ssl()
+            if self.separate_offline:
+                self.run_offline_phase()
+            if self.native_baseline:
+                self.build_native_binary()
+
+        for i in missing:
+            self.record_repetition(i, *self.run_repetition(i))
+
+        self.summarize()
+
+    def missing_repetitions(self) -> list:
+        """Repetitions that the results database has no measurement of."""
+
+        measured = results_db.repetitions(self.point)
+        return [i for i in range(self.repetitions) if i not in measured]
+
+    def record_repetition(
+        self, repetition: int, time: float, outputs: dict, rows: list, native: dict
+    ) -> None:
+        """Stores a finished repetition, so that a resumed run skips it."""
+
+        metrics.save_rows(rows, "experiment/results")
+        results_db.save_repetition(self.point, repetition, time, outputs, rows)
+        for mode, (native_time, correct) in native.items():
+            results_db.save_native_run(self.point, repetition, mode, native_time, correct)
+
+    def summarize(self) -> None:
+        """Writes the general results file from all measured repetitions,
+        those of earlier runs included."""
+
+        measured = results_db.repetitions(self.point)
+        self.offline_time = results_db.offline_time(self.point)
+        self.times = [measured[i][0] for i in range(self.repetitions)]
+        self.outputs = [measured[i][1] for i in range(self.repetitions)]
+        self.native_runs = results_db.native_runs(self.point)
 
         self.average_time = sum(self.times) / len(self.times)
         self.save_general_results_file()
 
+    def numbered_repetition(self, repetition: int) -> tuple:
+        """Result of a repetition with its number, for results that arrive
+        out of order."""
+
+        return repetition, self.run_repetition(repetition)
+
     def run_repetition(self, repetition):
         logging.info("Executing repetition {}".format(repetition))
 
-        if self.net_controller is not None:
-            self.net_controller.start()
+        if self.isolated:
+            # Own input files, own port range and the cores of this worker,
+            # so that concurrent repetitions never share any of them
+            workspace = os.path.abspath(
+                os.path.join(
+                    config.get("workspace_path", "experiment/workspaces"),
+                    "{}-{}".format(self.program_name(), repetition),
+                )
+            )
+            os.makedirs(workspace, exist_ok=True)
+            input_prefix = os.path.join(workspace, "Input")
+            port_base = config.get("port_base", 10000) + repetition * self.n_parties
+            first_core = worker_slot * self.cores_per_repetition
+            cores = "{}-{}".format(first_core, first_core + self.cores_per_repetition - 1)
+
+            self.create_mpc_input_files(input_prefix)
+            result, party_metrics = self.run_mpc_protocol(input_prefix, port_base, cores)
+        else:
+            input_prefix = os.path.join(config["mp_spdz_input_path"], "Input")
+            cores = None
+
+            if self.net_controller is not None:
+                self.net_controller.start()
 
-        self.setup_ssl()
-        self.create_mpc_input_files()
-        self.compile_mpc_file()
-        result = self.run_mpc_protocol()
+            self.create_mpc_input_files()
+            self.create_public_input_file(repetition)
+            # All parties of the previous repetition have been reaped, so
+            # only their ports can be in the way
+            port_base = free_port_base(config.get("port_base", 10000), self.n_parties)
+            result, party_metrics = self.run_mpc_protocol(port_base=port_base)
 
-        if self.net_controller is not None:
-            self.net_controller.stop()
+            if self.net_controller is not None:
+                self.net_controller.stop()
 
         self.has_finished = True
         self.save_individual_result_file(repetition, result)
 
         running_time = self.extract_time(result)
-        return running_time
+        outputs = self.extract_outputs(result)
+        native = {}
+        if self.native_baseline:
+            native = self.run_native_baseline(repetition, input_prefix, cores, outputs)
+        return running_time, outputs, self.metric_rows(repetition, party_metrics), native
+
+    def build_native_binary(self) -> None:
+        """Builds the native shifting knapsack if its source is newer."""
+
+        binary = config.get("native_binary_path", "experiment/native/shifting_knapsack")
+        if os.path.exists(binary) and os.path.getmtime(binary) >= os.path.getmtime(native_source):
+            return
+        logging.info("Building the native shifting knapsack")
+        os.makedirs(os.path.dirname(binary), exist_ok=True)
+        subprocess.run(
+            ["g++", "-O2", "-std=c++17", "-o", binary, native_source], check=True
+        )
+
+    def run_native_baseline(self, repetition: int, input_prefix: str, cores, outputs: dict) -> dict:
+        """Solves the inputs of a repetition with the native shifting
+        knapsack in every mode and checks its values against the outputs of
+        the MPC program. Returns mode -> (time, whether the values agree)."""
+
+        binary = config.get("native_binary_path", "experiment/native/shifting_knapsack")
+        native = {}
+        for mode in native_modes:
+            command = [
+                os.path.abspath(binary),
+                mode,
+                str(self.max_weight),
+                str(self.instances),
+                input_prefix,
+            ] + [str(tx_count) for tx_count in self.tx_counts]
+            if cores is not None:
+                command = ["taskset", "-c", cores] + command
+            native_result = subprocess.run(
+                command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT
+            )
+            native_output = native_result.stdout.decode("utf-8")
+            if native_result.returncode != 0:
+                raise subprocess.CalledProcessError(
+                    native_result.returncode, command, native_output
+                )
+
+            values = self.extract_outputs(native_output)["knapsack_value"]
+            correct = values == outputs.get("knapsack_value")
+            if not correct:
+                logging.error(
+                    "Repetition {}: native {} values {} differ from MPC values {}".format(
+                        repetition, mode, values, outputs.get("knapsack_value")
+                    )
+                )
+            native[mode] = (self.extract_time(native_output), correct)
+        return native
+
+    def metric_rows(self, repetition: int, party_metrics: list) -> list:
+        """Rows of experiment/results/metrics.*, the metrics of each party
+        keyed by the parameters of the experiment."""
+
+        date = str(datetime.now())
+        rows = []
+        for party, party_metric in enumerate(party_metrics):
+            row = {
+                "date": date,
+                "point": self.point,
+                "algorithm": self.algorithm,
+                "protocol": self.protocol,
+                "max_weight": self.max_weight,
+                "max_value": self.max_value,
+                "n_parties": self.n_parties,
+                "tx_per_party": self.tx_per_party,
+                "weight_bound": self.weight_bound,
+                "tx_bound": self.tx_bound,
+                "value_bound": self.value_bound,
+                "instances": self.instances,
+                "incremental": self.incremental,
+                "separate_offline": self.separate_offline,
+                "network": json.dumps(self.network, sort_keys=True) if self.network else None,
+                "repetition": repetition,
+                "party": party,
+            }
+            row.update(party_metric)
+            rows.append(row)
+        return rows
 
     def save_general_results_file(self) -> None:
         if not os.path.exists("experiment/results"):
@@ -119,6 +457,10 @@ class Experiment:
             "Max. weight: {}".format(self.max_weight),
             "# Parties: {}".format(self.n_parties),
             "# Tx per party: {}".format(self.tx_per_party),
+            "# Instances: {}".format(self.instances),
+            "Incremental: {}".format(self.incremental),
+            "Separate offline phase: {}".format(self.separate_offline),
+            "Native baseline: {}".format(self.native_baseline),
             "Date: {}".format(str(date)),
         ]
 
@@ -127,8 +469,28 @@ class Experiment:
             repetition_results.append(
                 "Time repetition {}: {}".format(str(i), self.times[i])
             )
+        for i in range(self.repetitions):
+            repetition_results.append(
+                "Output repetition {}: {}".format(str(i), json.dumps(self.outputs[i]))
+            )
 
-        statistics = ["Avg. running time: {}".format(self.average_time)]
+        statistics = [
+            "Avg. running time: {}".format(self.average_time),
+            "Offline time (Fake-Offline.x dealer): {}".format(self.offline_time),
+            "Avg. time per instance: {}".format(self.average_time / self.instances),
+            "Instances per second: {}".format(self.instances / self.average_time),
+        ]
+        for mode in native_modes:
+            if mode in self.native_runs:
+                runs = self.native_runs[mode]
+                statistics += [
+                    "Avg. native {} time: {}".format(
+                        mode, sum(time for time, correct in runs) / len(runs)
+                    ),
+                    "Native {} results agreeing: {}/{}".format(
+                        mode, sum(correct for time, correct in runs), len(runs)
+                    ),
+                ]
 
         contents = header + [""] + repetition_results + [""] + statistics
         contents_str = "\n".join(contents)
@@ -144,6 +506,23 @@ class Experiment:
                 return float(time_str)
         raise Exception("Time flag not found")
 
+    def extract_outputs(self, result: str) -> dict:
+        """Parses the RESULT lines that the programs print, one per result,
+        into a dictionary from label to list of values."""
+        outputs = {}
+        for line in result.split("\n"):
+            fields = line.split()
+            if len(fields) < 2 or fields[0] != "RESULT":
+                continue
+            values = []
+            for field in fields[2:]:
+                try:
+                    values.append(int(field))
+                except ValueError:
+                    values.append(float(field))
+            outputs[fields[1]] = values
+        return outputs
+
     def save_individual_result_file(self, repetition: int, result: str) -> None:
         """Saves the result of the experiment in a file."""
 
@@ -171,49 +550,170 @@ class Experiment:
 
         logging.info("Results saved in file {}".format(name))
 
-    def run_mpc_protocol(self) -> str:
-        """Runs the MPC protocol of the compiled algorithm using MP-SDPZ."""
+    def run_mpc_protocol(self, input_prefix=None, port_base=None, cores=None) -> tuple:
+        """Runs the MPC protocol of the compiled algorithm using MP-SDPZ.
+
+        Every party is started separately instead of through the MP-SPDZ
+        scripts, so that each one is a child process whose resource usage
+        can be collected.
+
+        :param input_prefix: prefix of the input files (-IF), by default the
+            Player-Data files
+        :param port_base: first port of the parties (-pn)
+        :param cores: cores the parties are pinned to, in taskset -c format
+        :returns: the output of party 0 and a dict of metrics per party"""
 
         logging.info(
             "Running protocol {} for algorithm {}".format(self.protocol, self.algorithm)
         )
-        path_protocol = os.path.join("./Scripts", self.protocol)
+        if port_base is None:
+            port_base = config.get("port_base", 10000)
+        args = ["-pn", str(port_base)]
+        # Parties in network namespaces reach each other by the addresses in
+        # the hosts file, otherwise party 0 on localhost coordinates them
+        if isinstance(self.net_controller, NamespaceNetwork):
+            args += ["-ip", self.net_controller.hosts_path]
+        else:
+            args += ["-h", "localhost"]
+        if self.protocol not in fixed_party_protocols:
+            args += ["-N", str(self.n_parties)]
+        if input_prefix is not None:
+            args += ["-IF", input_prefix]
+        if self.separate_offline:
+            args += ["-F"] + self.prime_length_args()
+
+        # Outputs go to files, so that no party blocks on a full pipe
+        outputs = [tempfile.TemporaryFile() for i in range(self.n_parties)]
+        parties = []
+        for i in range(self.n_parties):
+            command = [
+                os.path.join(".", protocol_binaries[self.protocol]),
+                "-p",
+                str(i),
+            ] + args + [self.program_name()]
+            if isinstance(self.net_controller, NamespaceNetwork):
+                command = self.net_controller.party_prefix(i) + command
+            if cores is not None:
+                command = ["taskset", "-c", cores] + command
+            parties.append(
+                subprocess.Popen(
+                    command,
+                    cwd=config["mp_spdz_root"],
+                    stdout=outputs[i],
+                    stderr=subprocess.STDOUT,
+                )
+            )
+        start = delay.time()
+
+        # Each party is reaped with wait4 as soon as it exits, which yields
+        # its own resource usage and end time. taskset and ip netns exec
+        # exec into the party binary, so the usage is that of the party.
+        usages = [None] * self.n_parties
+        while None in usages:
+            for i, party in enumerate(parties):
+                if usages[i] is not None:
+                    continue
+                pid, status, rusage = os.wait4(party.pid, os.WNOHANG)
+                if pid != 0:
+                    party.returncode = os.waitstatus_to_exitcode(status)
+                    usages[i] = metrics.resource_metrics(rusage, delay.time() - start)
+            delay.sleep(0.01)
+
+        results = []
+        for output in outputs:
+            output.seek(0)
+            results.append(output.read().decode("utf-8"))
+            output.close()
+
+        for i, party in enumerate(parties):
+            if party.returncode != 0:
+                raise subprocess.CalledProcessError(party.returncode, party.args, results[i])
+
+        party_metrics = []
+        for i in range(self.n_parties):
+            party_metric = metrics.parse_party_output(results[i])
+            party_metric.update(usages[i])
+            party_metrics.append(party_metric)
+        return results[0], party_metrics
 
-        mpc_file_name = self.algorithm.split("/")[-1].rstrip(
-            ".mpc"
-        ) + "-{}-{}-{}".format(self.n_parties, self.max_weight, self.tx_per_party)
-        run_mpc_result = subprocess.run(
-            ["env", "PLAYERS={}".format(self.n_parties), path_protocol, mpc_file_name],
-            cwd=config["mp_spdz_root"],
-            stdout=subprocess.PIPE,
-            stderr=subprocess.STDOUT,
+    def program_name(self) -> str:
+        """Name under which MP-SPDZ stores the compiled program."""
+
+        return self.algorithm.split("/")[-1].rstrip(".mpc") + "-" + "-".join(
+            self.compile_args()
         )
-        run_mpc_result.check_returncode()
-        return run_mpc_result.stdout.decode("utf-8")
 
-    def create_mpc_input_files(self) -> None:
-        """Creates the input files according to the experiment specifications."""
+    def compile_args(self) -> list:
+        """Arguments of the program after the file name."""
 
-        for i in range(self.n_parties):
-            rand_weights = random.choices(
-                range(1, self.max_weight + 1), k=self.tx_per_party
-            )
-            rand_values = random.choices(range(self.max_value + 1), k=self.tx_per_party)
-            input_file_name = "Input-P{}-0".format(i)
-            path_file = os.path.join(config["mp_spdz_input_path"], input_file_name)
+        args = [
+            str(self.n_parties),
+            str(self.weight_bound),
+            str(self.tx_bound),
+            str(self.value_bound),
+            str(self.instances),
+        ]
+        if self.incremental:
+            args.append("incremental")
+        return args
+
+    def create_mpc_input_files(self, input_prefix=None) -> None:
+        """Creates the input files according to the experiment specifications.
+
+        For every instance, every party writes a line of values and a line
+        of weights with tx_bound entries each; the entries after the party's
+        own count are ignored by the program. The files are named
+        <input_prefix>-P<party>-0, in Player-Data by default."""
+
+        if input_prefix is None:
+            input_prefix = os.path.join(config["mp_spdz_input_path"], "Input")
+
+        for i, tx_count in enumerate(self.tx_counts):
+            padding = [0] * (self.tx_bound - tx_count)
+            lines = []
+            for instance in range(self.instances):
+                rand_weights = random.choices(
+                    range(1, self.max_weight + 1), k=tx_count
+                ) + padding
+                rand_values = random.choices(range(self.max_value + 1), k=tx_count) + padding
+                lines.append(" ".join(map(str, rand_values)))
+                lines.append(" ".join(map(str, rand_weights)))
+            path_file = "{}-P{}-0".format(input_prefix, i)
             with open(path_file, "w") as file_input:
                 logging.info("Creating input file for party P{}".format(i))
-                file_input.write(
-                    "{}\n{}".format(
-                        " ".join(map(str, rand_weights)),
-                        " ".join(map(str, rand_values)),
-                    )
+                file_input.write("\n".join(lines))
+
+    def create_public_input_file(self, repetition: int) -> None:
+        """Writes the public runtime inputs of the compiled program: the
+        capacity followed by the number of transactions of each party, once
+        per instance. In incremental mode they are preceded by a flag that
+        starts a new sequence in the first repetition."""
+
+        path_public_input = os.path.join(
+            config["mp_spdz_root"], "Programs", "Public-Input", self.program_name()
+        )
+        os.makedirs(os.path.dirname(path_public_input), exist_ok=True)
+        with open(path_public_input, "w") as file_public_input:
+            if self.incremental:
+                file_public_input.write("{}\n".format(int(repetition == 0)))
+                os.makedirs(
+                    os.path.join(config["mp_spdz_root"], "Persistence"), exist_ok=True
+                )
+            for instance in range(self.instances):
+                file_public_input.write(
+                    " ".join(map(str, [self.max_weight] + self.tx_counts)) + "\n"
                 )
 
     def compile_mpc_file(self) -> None:
-        """Compiles the .mpc file using MP-SDPZ."""
+        """Compiles the .mpc file using MP-SDPZ, or restores an identical
+        earlier compilation from the cache."""
+
+        compile_cache.compile(*self.compile_job())
+
+    def compile_job(self) -> tuple:
+        """Path of the .mpc file relative to the MP-SPDZ root, compile.py
+        flags, program arguments and program name."""
 
-        logging.info("Compiling MPC file {}".format(self.algorithm))
         path_mpc_file = os.path.join("..", self.algorithm)
 
         # Set the compilation flag for rings and fields
@@ -223,27 +723,69 @@ class Experiment:
         elif self.protocol in field_protocols:
             domain = "-F"
 
-        # Set the ring size for the greedy aproach in a different way given the
-        # use of fixed-point arithmetic.
-        ring_size = "64"
-        if self.algorithm == "mpc_knapsack_auction/knapsack_auction.mpc":
-            ring_size = "77"
-
-        compile_result = subprocess.run(
-            [
-                "./compile.py",
-                domain,
-                ring_size,
-                path_mpc_file,
-                str(self.n_parties),
-                str(self.max_weight),
-                str(self.tx_per_party),
-            ],
+        # The programs set their bit length from the same bounds, so the
+        # domain is the smallest one that holds their comparisons
+        n_items = self.n_parties * self.tx_bound
+        n_rows = padded_length(n_items) if self.algorithm in padded_algorithms else n_items
+        bit_lengths = knapsack_bit_lengths(
+            n_items, self.weight_bound, self.value_bound, n_rows, self.incremental
+        )
+        size = str(domain_size(max(bit_lengths.values()), domain == "-R"))
+
+        return path_mpc_file, [domain, size], self.compile_args(), self.program_name()
+
+    def run_offline_phase(self) -> None:
+        """Generates the preprocessing of all repetitions into Player-Data
+        with Fake-Offline.x and stores how long it took. Every online run
+        with -F reads the files from the start, so one generation serves
+        all repetitions; it is not reused across experiments, which may
+        overwrite the same files. The stored time is that of the insecure
+        dealer, not of the protocol's own offline phase."""
+
+        logging.info("Generating preprocessing for {} parties".format(self.n_parties))
+        job = self.compile_job()
+        domain, size = job[1]
+        compile_output = compile_cache.output(*job)
+
+        # Items per type, from the largest amount that compile.py reports
+        # for one run, with a margin for what the statistics do not count
+        items = math.ceil(
+            largest_requirement(compile_output) * config.get("preprocessing_margin", 1.5)
+        )
+        command = [
+            "./Fake-Offline.x",
+            str(self.n_parties),
+            "-d",
+            str(max(items, config.get("preprocessing_items", 1000))),
+        ]
+        if domain == "-R":
+            command += ["-Z", size]
+        else:
+            command += self.prime_length_args()
+
+        # edaBits are only generated for the lengths asked for, which are
+        # those the compiled program requires
+        lengths = edabit_lengths(compile_output)
+        if lengths:
+            command += ["-e", ",".join(str(length) for length in lengths)]
+
+        start = delay.time()
+        offline_result = subprocess.run(
+            command,
             cwd=config["mp_spdz_root"],
             stdout=subprocess.DEVNULL,
             stderr=subprocess.STDOUT,
         )
-        compile_result.check_returncode()
+        offline_result.check_returncode()
+        results_db.save_offline_time(self.point, delay.time() - start)
+
+    def prime_length_args(self) -> list:
+        """-lgp argument that makes the parties pick the prime of the
+        generated preprocessing, empty for rings."""
+
+        if self.protocol in ring_protocols:
+            return []
+        return ["-lgp", str(config.get("prime_length", 128))]
 
     def setup_ssl(self) -> None:
         """Setups the SSL for the number of parties specified in the experiment."""
@@ -293,38 +835,144 @@ class NetworkController:
         logging.info("Shapper successfully stopped.")
 
 
-if __name__ == "__main__":
-    time = datetime.now()
-    for exp in config["experiments"]:
-        algorithm = exp["algorithm"]
-        protocol = exp["protocol"]
-        max_weight = exp["max_weight"]
-        max_value = exp["max_value"]
-        n_parties = exp["n_parties"]
-        tx_per_party = exp["tx_per_party"]
-        repetitions = exp["repetitions"]
-
-        has_net_limit_response = exp["has_net_limit"]
-
-        if has_net_limit_response:
-            bandwidth = exp["net_limits"]["bandwidth"]
-            latency = exp["net_limits"]["latency"]
-            net_controller = NetworkController(bandwidth, latency)
-        else:
-            net_controller = None
-
-        experiment = Experiment(
-            algorithm,
-            protocol,
-            max_weight,
-            max_value,
-            tx_per_party,
-            n_parties,
-            repetitions,
-            net_controller,
+class NamespaceNetwork:
+    """
+    Network controller that emulates every party on its own host: each
+    party runs in its own network namespace, and every direction of every
+    link between two parties is shaped separately.
+    """
+
+    link_defaults = {"bandwidth": "10gbit", "latency": "0ms", "jitter": "0ms", "loss": "0%"}
+
+    def __init__(self, n_parties: int, default: dict, links: list) -> None:
+        """default applies to all links and every entry of links, with the
+        pair of parties under "between", overrides it in both directions."""
+
+        self.n_parties = n_parties
+        self.hosts_path = os.path.abspath("experiment/netns-hosts")
+
+        # links[i][j] shapes the traffic from party i to party j
+        self.links = [
+            [dict(self.link_defaults, **default) for j in range(n_parties)]
+            for i in range(n_parties)
+        ]
+        for link in links:
+            i, j = link["between"]
+            shaping = {key: value for key, value in link.items() if key != "between"}
+            self.links[i][j].update(shaping)
+            self.links[j][i].update(shaping)
+
+    def netns(self, *args) -> None:
+        netns_result = subprocess.run(
+            ["bash", config.get("netns_path", "experiment/netns.sh")] + [str(arg) for arg in args],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.STDOUT,
         )
+        netns_result.check_returncode()
 
-        if exp["in_parallel"]:
+    def start(self) -> None:
+        """Creates the namespaces, shapes the links and writes the file with
+        the address of every party."""
+
+        logging.info("Creating network namespaces.")
+        self.netns("start", self.n_parties)
+        for i in range(self.n_parties):
+            for j in range(self.n_parties):
+                if i != j:
+                    link = self.links[i][j]
+                    self.netns(
+                        "shape", i, j,
+                        link["bandwidth"], link["latency"], link["jitter"], link["loss"],
+                    )
+
+        with open(self.hosts_path, "w") as hosts_file:
+            for i in range(self.n_parties):
+                hosts_file.write("10.77.0.{}\n".format(i + 1))
+        logging.info("Network namespaces successfully created.")
+
+    def stop(self) -> None:
+        """Deletes the namespaces, which also removes their links."""
+
+        logging.info("Deleting network namespaces.")
+        self.netns("stop", self.n_parties)
+        logging.info("Network namespaces successfully deleted.")
+
+    def party_prefix(self, party: int) -> list:
+        """Command prefix that runs a command in the namespace of party."""
+
+        return ["ip", "netns", "exec", "mpc-p{}".format(party)]
+
+
+def build_experiment(exp: dict) -> Experiment:
+    """Experiment of an entry of the experiments list."""
+
+    algorithm = exp["algorithm"]
+    protocol = exp["protocol"]
+    max_weight = exp["max_weight"]
+    max_value = exp["max_value"]
+    n_parties = exp["n_parties"]
+    tx_per_party = exp["tx_per_party"]
+    repetitions = exp["repetitions"]
+
+    has_net_limit_response = exp["has_net_limit"]
+
+    network = None
+    if "netns" in exp:
+        network = {"netns": exp["netns"]}
+        net_controller = NamespaceNetwork(
+            n_parties, exp["netns"].get("default", {}), exp["netns"].get("links", [])
+        )
+    elif has_net_limit_response:
+        bandwidth = exp["net_limits"]["bandwidth"]
+        latency = exp["net_limits"]["latency"]
+        network = {"net_limits": exp["net_limits"]}
+        net_controller = NetworkController(bandwidth, latency)
+    else:
+        net_controller = None
+
+    return Experiment(
+        algorithm,
+        protocol,
+        max_weight,
+        max_value,
+        tx_per_party,
+        n_parties,
+        repetitions,
+        net_controller,
+        exp.get("weight_bound"),
+        exp.get("tx_bound"),
+        exp.get("value_bound"),
+        exp.get("instances", 1),
+        exp.get("incremental", False),
+        exp.get("separate_offline", False),
+        exp.get("native_baseline", False),
+        network,
+    )
+
+
+if __name__ == "__main__":
+    time = datetime.now()
+    experiments = []
+    for exp in expand_config(config):
+        experiment = build_experiment(exp)
+        experiment.point = results_db.add_point(exp)
+
+        # Points whose repetitions were all measured by an earlier,
+        # interrupted run are skipped
+        if not experiment.missing_repetitions():
+            logging.info("Skipping measured experiment {}".format(json.dumps(exp)))
+            continue
+        experiments.append((experiment, exp["in_parallel"]))
+
+    # All distinct programs are compiled up front in parallel, so that the
+    # experiments below only restore them from the cache
+    compile_cache.precompile(
+        [experiment.compile_job() for experiment, in_parallel in experiments],
+        config.get("compile_jobs", multiprocessing.cpu_count()),
+    )
+
+    for experiment, in_parallel in experiments:
+        if in_parallel:
             experiment.parallel_run()
         else:
             experiment.regular_run()
@@ -0,0 +1,70 @@
+# Expansion of parameter sweeps into the experiment entries of config.json.
+#
+# A sweep has a "base" entry with the fields shared by all its experiments
+# and a "grid" from field name to the values it takes. The experiments are
+# the cross product of the grid, in order, each one the base with the grid
+# values filled in. A grid value is either a list or an inclusive range
+# {"from": a, "to": b, "step": s}. The grid field "network" takes names of
+# the "network_profiles" of the config, whose fields are merged into the
+# experiment, and "same_as" copies fields from others after expansion:
+#
+#     "network_profiles": {
+#         "lan": {"has_net_limit": true,
+#                 "net_limits": {"bandwidth": "10gbps", "latency": "0.3ms"}},
+#         "none": {"has_net_limit": false}
+#     },
+#     "sweeps": [{
+#         "base": {"n_parties": 3, "repetitions": 3, "tx_per_party": 100,
+#                  "in_parallel": false},
+#         "grid": {"algorithm": ["mpc_knapsack_auction/knapsack_auction.mpc"],
+#                  "protocol": ["mal-rep-ring.sh", "semi2k.sh"],
+#                  "max_weight": [100, 250, 500],
+#                  "network": ["lan", "none"]},
+#         "same_as": {"max_value": "max_weight"}
+#     }]
+import copy
+import itertools
+
+
+def grid_values(name: str, spec) -> list:
+    """Values of one grid field."""
+
+    if isinstance(spec, list):
+        return spec
+    if isinstance(spec, dict) and "from" in spec and "to" in spec:
+        return list(range(spec["from"], spec["to"] + 1, spec.get("step", 1)))
+    raise ValueError("Grid field {} is neither a list nor a range".format(name))
+
+
+def expand_sweep(sweep: dict, network_profiles: dict) -> list:
+    """Experiment entries of a sweep, in the order of its grid."""
+
+    grid = sweep.get("grid", {})
+    names = list(grid)
+    experiments = []
+    for values in itertools.product(*(grid_values(name, grid[name]) for name in names)):
+        exp = copy.deepcopy(sweep.get("base", {}))
+        for name, value in zip(names, values):
+            if name == "network":
+                if value not in network_profiles:
+                    raise ValueError("Unknown network profile {}".format(value))
+                exp.update(copy.deepcopy(network_profiles[value]))
+                exp["network"] = value
+            else:
+                exp[name] = value
+        for name, source in sweep.get("same_as", {}).items():
+            exp[name] = exp[source]
+        exp.setdefault("has_net_limit", False)
+        exp.setdefault("in_parallel", False)
+        experiments.append(exp)
+    return experiments
+
+
+def expand_config(config: dict) -> list:
+    """The hand-written experiments of the config followed by the
+    experiments of every sweep."""
+
+    experiments = list(config.get("experiments", []))
+    for sweep in config.get("sweeps", []):
+        experiments += expand_sweep(sweep, config.get("network_profiles", {}))
+    return experiments
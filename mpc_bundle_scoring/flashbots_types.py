@@ -6,11 +6,18 @@ sys.path.append("../MP-SPDZ/")
 from decimal import Decimal
 
 class Tx:
-    def __init__(self, gas, gas_price, fee_cap, priority_fee):
+    def __init__(self, gas, gas_price, fee_cap, priority_fee, tx_id):
         self.gas = gas
         self.gas_price = gas_price
         self.fee_cap = fee_cap
         self.priority_fee = priority_fee
+        self.tx_id = tx_id
+
+    def __eq__(self, other):
+        return self.tx_id == other.tx_id
+
+    def __hash__(self):
+        return hash(self.tx_id)
 
     def calculate_effective_fee_per_gas(self, basefee):
         return min(self.fee_cap, basefee + self.priority_fee)
@@ -24,17 +31,17 @@ class Tx:
         gas_price = round(self.gas_price * (2**f))
         fee_cap = round(self.fee_cap * (2**f))
         priority_fee = round(self.priority_fee * (2**f))
-        return Tx(gas, gas_price, fee_cap, priority_fee)
+        return Tx(gas, gas_price, fee_cap, priority_fee, self.tx_id)
 
     def from_int_rep(self, f=16):
         gas = self.gas / (2**f)
         gas_price = self.gas_price / (2**f)
         fee_cap = self.fee_cap / (2**f)
         priority_fee = self.priority_fee / (2**f)
-        return Tx(gas, gas_price, fee_cap, priority_fee)
+        return Tx(gas, gas_price, fee_cap, priority_fee, self.tx_id)
 
     def __str__(self):
-        return "{} {} {} {}".format(self.gas, self.gas_price, self.fee_cap, self.priority_fee)
+        return "{} {} {} {} {}".format(self.gas, self.gas_price, self.fee_cap, self.priority_fee, self.tx_id)
 
 class Bundle:
     def __init__(self, coinbase_difference, basefee, txs=[]):
@@ -9,7 +9,8 @@ def generate_random_tx():
     gas_price = random.uniform(0, 3000001)
     fee_cap = random.uniform(0, 3000001)
     priority_fee = random.uniform(0, 3000001)
-    return flashbots_types.Tx(gas, gas_price, fee_cap, priority_fee)
+    tx_id = random.getrandbits(48)
+    return flashbots_types.Tx(gas, gas_price, fee_cap, priority_fee, tx_id)
 
 def generate_data_file(): 
     mempool_txs = []
@@ -22,11 +23,10 @@ def generate_data_file():
                 tx = generate_random_tx()
                 txs.append(tx.to_int_rep())
 
-            bundle = flashbots_types.Bundle(txs)
             mempool_txs.extend(random.sample(txs, 3))
             coinbase_difference = random.uniform(0, 3000001)
             basefee = random.uniform(0, 3000001)
-            f.write(str(bundle) + "\n")
+            f.write("\n".join(str(tx) for tx in txs) + "\n")
             f.write(str(coinbase_difference) + "\n")
             f.write(str(basefee) + "\n")
     with open("../MP-SPDZ/Programs/Public-Input/bundle_scoring", "w+") as m:
@@ -40,7 +40,7 @@ def expected_scores():
     with open("../MP-SPDZ/Programs/Public-Input/bundle_scoring", "r") as public_data:
         for line in public_data.readlines():
             line = line.split(" ")
-            tx = flashbots_types.Tx(int(line[0]), int(line[1]), int(line[2]), int(line[3])).from_int_rep()
+            tx = flashbots_types.Tx(int(line[0]), int(line[1]), int(line[2]), int(line[3]), int(line[4])).from_int_rep()
             mempool.append(tx)
 
     # Load txs
@@ -50,7 +50,7 @@ def expected_scores():
                 txs_bundle = []
                 for j in range(6):
                     line = private_data.readline().split(" ")
-                    tx = flashbots_types.Tx(int(line[0]), int(line[1]), int(line[2]), int(line[3])).from_int_rep()
+                    tx = flashbots_types.Tx(int(line[0]), int(line[1]), int(line[2]), int(line[3]), int(line[4])).from_int_rep()
                     txs_bundle.append(tx)
                 coinbase_difference = float(private_data.readline().strip())
                 basefee = float(private_data.readline().strip())
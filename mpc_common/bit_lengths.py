@@ -0,0 +1,107 @@
+# Minimal bit lengths of the secret comparisons, derived from the public
+# bounds of a program. Plain Python, so that the harness can size the
+# compilation domain with the same numbers the programs compare with.
+
+# Ring sizes the MP-SPDZ ring machines are built for. 64 and 72 are
+# available by default, 128 needs binaries built with -DRING_SIZE=128.
+RING_SIZES = (64, 72, 128)
+
+
+def bit_length_of(bound):
+    """Number of bits of the non-negative integers up to bound."""
+    return max(1, int(bound).bit_length())
+
+
+def comparison_bit_length(bound):
+    """Bit length for comparing two integers in [0, bound]. The comparison
+    works on their difference, which needs one more bit for the sign."""
+    return bit_length_of(bound) + 1
+
+
+def fixed_point_k(integer_bound, f):
+    """Total number of bits k of a signed fixed-point type with f
+    fractional bits whose values stay within [-integer_bound,
+    integer_bound]."""
+    return f + comparison_bit_length(integer_bound)
+
+
+def padded_length(n):
+    """Smallest power of two that is at least n, the length the sorting
+    network needs."""
+    length = 1
+    while length < n:
+        length *= 2
+    return length
+
+
+def knapsack_bit_lengths(n_items, weight_bound, value_bound, n_rows=None, incremental=False):
+    """Bit lengths of the comparisons of the knapsack programs.
+
+    :param n_items: number of item slots, dummies included
+    :param weight_bound: compile-time bound on the capacity; dummy items
+        weigh one more
+    :param value_bound: upper bound on the value of a single item. Real
+        items weigh at least 1, so a sum of values that fits the capacity
+        has at most weight_bound terms, however many items have been seen.
+        The DP compares sums with at most one more term.
+    :param n_rows: rows that the auction sums space over, padding rows
+        included; defaults to n_items
+    :param incremental: whether the DP row collects items over several
+        runs, so that its sums are not bounded by the items of one run
+    :returns: dict with the bit length of comparisons between weights,
+        between sums of values (DP cells, auction surplus), between sums of
+        weights (auction prefix sums) and between value-weight cross
+        products (auction ratio sort)"""
+    dummy_weight = weight_bound + 1
+    if n_rows is None:
+        n_rows = n_items
+    return {
+        "weight": comparison_bit_length(dummy_weight),
+        "value": comparison_bit_length(
+            (dummy_weight if incremental else min(n_items, dummy_weight)) * value_bound
+        ),
+        "space": comparison_bit_length(n_rows * dummy_weight),
+        "ratio": comparison_bit_length(value_bound * dummy_weight),
+    }
+
+
+def bundle_bit_lengths(txs_per_bundle, precision, gas_bound, fee_bound):
+    """Fixed-point sizes of mpc_bundle_scoring.
+
+    :param txs_per_bundle: number of txs in every bundle
+    :param precision: fractional bits of the inputs
+    :param gas_bound: bound on the integer part of a gas amount
+    :param fee_bound: bound on the integer part of a fee per gas
+    :returns: dict with the total bits of a bundle's numerator (coinbase
+        difference plus gas times miner fee of every tx) and of its sum of
+        gas, the total and fractional bits of the score division, and the
+        program bit length of ranking (cross products) and of scoring.
+        sfix division needs twice the bits of its operands, so scores are
+        divided with fewer fractional bits when that would not fit the
+        largest ring. division_f below 1 means that no ring can score."""
+    numerator_k = fixed_point_k(fee_bound + txs_per_bundle * gas_bound * fee_bound, precision)
+    gas_k = fixed_point_k(txs_per_bundle * gas_bound, precision)
+    division_k = min(numerator_k, (RING_SIZES[-1] - 1) // 2)
+    return {
+        "numerator_k": numerator_k,
+        "gas_k": gas_k,
+        "division_k": division_k,
+        "division_f": precision - (numerator_k - division_k),
+        "ranking": numerator_k + gas_k,
+        "scores": 2 * division_k,
+    }
+
+
+def domain_size(bit_length, ring):
+    """Size argument of compile.py for a program with this bit length.
+
+    A ring has to be strictly larger than the bit length of its
+    comparisons, so the smallest supported ring above it is chosen. For
+    fields the argument is the bit length itself and the prime is chosen
+    at runtime."""
+    if not ring:
+        return bit_length
+    for ring_size in RING_SIZES:
+        if ring_size > bit_length:
+            return ring_size
+    raise ValueError("No supported ring for bit length {}".format(bit_length))
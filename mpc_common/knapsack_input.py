@@ -0,0 +1,88 @@
+# Private input of the knapsack items, shared by the knapsack programs.
+#
+# The programs take the arguments <parties> <capacity bound> <items per
+# party bound> <value bound>, and are compiled once for them. The capacity
+# and the number of items of every party are public runtime inputs, and
+# unused slots become dummy items that never fit, so one bytecode serves
+# every block below the bounds. The bound on the value of an item sizes the
+# comparisons of values (mpc_common/bit_lengths.py). An optional fifth
+# argument is the number of independent instances solved together, each
+# with its own capacity, counts and items.
+from Compiler.library import public_input
+from Compiler.types import cint, regint, sint
+
+from padding import pad_with_dummies
+
+
+def read_public_counts(n_parties):
+    """Reads the public number of items of every party from the public
+    input, one value per party."""
+    return [public_input() for i in range(n_parties)]
+
+
+def read_items(n_parties, max_items, counts, dummy_weight):
+    """Reads the items of every party and lays them out contiguously.
+
+    Party i inputs max_items values followed by max_items weights in a
+    single vectorized input, so its input file has one line of values and
+    one line of weights, padded to max_items. Only the first counts[i] items
+    are real. The real items of all parties are packed one after the other
+    from slot 0, and the remaining slots hold dummy items of value 0 and
+    weight dummy_weight.
+
+    :param counts: public item count per party (int or regint, at most
+        max_items)
+    :returns: values and weights (sint Arrays of n_parties * max_items),
+        the owner of every slot (cint Array, -1 for dummies) and the total
+        number of real items (regint)"""
+    size = n_parties * max_items
+    values = sint.Array(size)
+    weights = sint.Array(size)
+    owners = cint.Array(size)
+    values.assign_all(0)
+    weights.assign_all(dummy_weight)
+    owners.assign_all(-1)
+
+    offset = regint(0)
+    for i in range(n_parties):
+        # A separate array per party keeps the inputs independent, so they
+        # are merged into one round
+        party_input = sint.Array(2 * max_items)
+        party_input.input_from(i)
+        party_values, party_weights = pad_with_dummies(
+            party_input.get_vector(0, max_items),
+            party_input.get_vector(max_items, max_items),
+            counts[i], dummy_weight)
+
+        # Written at the running offset, so the padding of this party is
+        # overwritten by the items of the next one
+        values.assign(party_values, base=offset)
+        weights.assign(party_weights, base=offset)
+        valid = cint(regint.inc(max_items) < regint(counts[i]).expand_to_vector(max_items))
+        owners.assign(valid * (i + 1) - 1, base=offset)
+        offset = offset + counts[i]
+
+    return values, weights, owners, offset
+
+
+def read_instances(n_parties, max_items, n_instances, dummy_weight):
+    """Reads n_instances independent knapsack instances. Each instance has
+    its own public capacity and item counts, followed in the public input by
+    those of the next instance, and its own items, which every party inputs
+    after those of the previous instance.
+
+    :returns: capacities (cint Array of n_instances) and values and weights
+        as sint Matrices with one row per item slot and one column per
+        instance, so a row holds the same item slot of every instance"""
+    n_items = n_parties * max_items
+    capacities = cint.Array(n_instances)
+    values = sint.Matrix(n_items, n_instances)
+    weights = sint.Matrix(n_items, n_instances)
+    for l in range(n_instances):
+        capacities[l] = public_input()
+        counts = read_public_counts(n_parties)
+        instance_values, instance_weights, owners, count = read_items(
+            n_parties, max_items, counts, dummy_weight)
+        values.set_column(l, instance_values.get_vector())
+        weights.set_column(l, instance_weights.get_vector())
+    return capacities, values, weights
@@ -0,0 +1,57 @@
+# Output stage shared by the MPC programs. All secret results are opened
+# together in a single reveal, and every result is printed on one line
+#
+#     RESULT <label> <value> <value> ...
+#
+# which experiment/run_experiment.py parses.
+from Compiler.library import for_range, print_ln, print_str
+from Compiler.types import Array, cfix, cint, sfix, sint
+
+PREFIX = "RESULT"
+
+
+class Output:
+    """Collects labelled results and reveals them in one opening."""
+
+    def __init__(self):
+        self.results = []
+        self.size = 0
+
+    def add(self, label, value):
+        """Schedules value to be printed under label.
+
+        :param value: sint or sfix register or vector, Array of either, or
+            a public value, which is printed without opening"""
+        if isinstance(value, Array):
+            value = value.get_vector()
+        if isinstance(value, sfix):
+            self.results.append((label, value.v, self.size, True))
+            self.size += value.v.size
+        elif isinstance(value, sint):
+            self.results.append((label, value, self.size, False))
+            self.size += value.size
+        else:
+            self.results.append((label, value, None, False))
+
+    def reveal(self):
+        """Opens all secret results at once and prints every result."""
+        opened = cint.Array(max(self.size, 1))
+        if self.size > 0:
+            secrets = sint.Array(self.size)
+            for label, value, base, is_sfix in self.results:
+                if base is not None:
+                    secrets.assign(value, base=base)
+            opened.assign(secrets.get_vector().reveal())
+
+        for label, value, base, is_sfix in self.results:
+            print_str("%s %s", PREFIX, label)
+            if base is None:
+                print_ln(" %s", value)
+                continue
+
+            @for_range(value.size)
+            def _(j):
+                x = opened[base + j]
+                print_str(" %s", cfix._new(x) if is_sfix else x)
+
+            print_ln("")
@@ -0,0 +1,18 @@
+# Oblivious padding of item lists up to the compile-time bounds, so that one
+# bytecode serves every instance below the bounds.
+from Compiler.types import cint, regint
+
+
+def pad_with_dummies(values, weights, count, dummy_weight):
+    """Replaces the slots from count on by dummy items of value 0 and weight
+    dummy_weight, which must exceed every capacity the program can be run
+    with. count is public but may only be known at runtime, and the
+    replacement is local to the shares.
+
+    :param values: sint vector
+    :param weights: sint vector of the same size
+    :param count: number of real items (int or regint)
+    :returns: padded values and weights"""
+    size = values.size
+    valid = cint(regint.inc(size) < regint(count).expand_to_vector(size))
+    return valid * values, valid * weights + (1 - valid) * dummy_weight
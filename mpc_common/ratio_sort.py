@@ -0,0 +1,58 @@
+# Oblivious ordering by ratio without secure division. Shared by the
+# knapsack auction and the bundle scoring programs.
+from Compiler.sorting import reveal_sort
+from Compiler.types import cint, regint, sint
+
+from bit_lengths import padded_length
+
+
+def sort_by_ratio(numerators, denominators, columns, bit_length=None):
+    # Sorts the rows by decreasing numerators[i] / denominators[i] and
+    # returns an Array with the original position of every sorted row.
+    #
+    # Only the key travels through the bitonic network: the two key arrays
+    # and the original position. Denominators are positive, so a/b < c/d
+    # is decided as a*d < c*b and no division is needed. The payload arrays
+    # in columns are then permuted once, by the original positions, however
+    # many there are. All arrays must have the same power-of-two length.
+    # bit_length bounds the cross products and defaults to the program bit
+    # length.
+    n = len(numerators)
+    half = n // 2
+    origins = sint.Array(n)
+    origins.assign(sint(regint.inc(n)))
+    arrays = [numerators, denominators, origins]
+
+    k = 2
+    while k <= n:
+        j = k // 2
+        while j > 0:
+            # Comparator t joins rows lower[t] and lower[t] + j. Blocks of k
+            # rows alternate between decreasing and increasing order.
+            lower = regint.inc(half, 0, 2 * j, j) + regint.inc(half, 0, 1, 1, j)
+            upper = lower + j
+            ascending = cint(regint.inc(half, 0, 1, k // 2, 2))
+
+            a = [x.value_type.load_mem(x.address + lower) for x in arrays]
+            b = [x.value_type.load_mem(x.address + upper) for x in arrays]
+            smaller = (a[0] * b[1]).less_than(b[0] * a[1], bit_length=bit_length)
+            swap = smaller + ascending - 2 * ascending * smaller
+
+            for x, a_x, b_x in zip(arrays, a, b):
+                new_lower = swap.if_else(b_x, a_x)
+                new_lower.store_in_mem(x.address + lower)
+                (a_x + b_x - new_lower).store_in_mem(x.address + upper)
+            j //= 2
+        k *= 2
+
+    if columns:
+        # Row k of the result is row origins[k] of the input. reveal_sort
+        # opens the positions only after a secure shuffle, so nothing about
+        # the order leaks.
+        payload = sint.Matrix(n, len(columns))
+        for i, column in enumerate(columns):
+            payload.set_column(i, column.get_vector())
+        reveal_sort(origins, payload, reverse=True)
+        for i, column in enumerate(columns):
+            column.assign(payload.get_column(i))
+    return origins
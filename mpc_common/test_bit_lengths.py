@@ -0,0 +1,65 @@
+# Checks that the bit lengths of the default program arguments fit the
+# domain that the harness compiles for:
+#
+#     python3 mpc_common/test_bit_lengths.py
+import unittest
+
+from bit_lengths import RING_SIZES, bundle_bit_lengths, domain_size, knapsack_bit_lengths, padded_length
+
+# Defaults of mpc_bundle_scoring: bounds of bundle_scoring.mpc and the txs
+# per bundle of simulate.py
+BUNDLE_PRECISION = 16
+BUNDLE_GAS_BOUND = 1 << 22
+BUNDLE_FEE_BOUND = 1 << 22
+BUNDLE_TXS = 6
+
+
+class BundleScoringTest(unittest.TestCase):
+    def setUp(self):
+        self.sizes = bundle_bit_lengths(
+            BUNDLE_TXS, BUNDLE_PRECISION, BUNDLE_GAS_BOUND, BUNDLE_FEE_BOUND
+        )
+
+    def test_default_modes_fit_128_bit_ring(self):
+        for mode in ["ranking", "scores"]:
+            bit_length = self.sizes[mode]
+            ring = domain_size(bit_length, True)
+            self.assertEqual(ring, 128, mode)
+            # The check of bundle_scoring.mpc accepts this ring
+            self.assertGreater(ring, bit_length, mode)
+
+    def test_scores_keep_fractional_bits(self):
+        self.assertGreaterEqual(self.sizes["division_f"], 1)
+        self.assertLess(2 * self.sizes["division_k"], RING_SIZES[-1])
+
+    def test_larger_bundles_still_rank(self):
+        sizes = bundle_bit_lengths(64, BUNDLE_PRECISION, BUNDLE_GAS_BOUND, BUNDLE_FEE_BOUND)
+        self.assertLess(sizes["ranking"], RING_SIZES[-1])
+
+
+class KnapsackAuctionTest(unittest.TestCase):
+    def test_space_holds_padded_prefix_sums(self):
+        # 3 parties with 100 bid slots each, padded to 512 rows
+        n_items, weight_bound, value_bound = 300, 100, 100
+        n_rows = padded_length(n_items)
+        self.assertGreater(n_rows, n_items)
+        bit_lengths = knapsack_bit_lengths(n_items, weight_bound, value_bound, n_rows)
+        # Every row, padding included, adds at most weight_bound + 1, and
+        # the comparison needs the sum below 2^(bits - 1)
+        self.assertLess(n_rows * (weight_bound + 1), 1 << (bit_lengths["space"] - 1))
+        unpadded = knapsack_bit_lengths(n_items, weight_bound, value_bound)
+        self.assertGreater(bit_lengths["space"], unpadded["space"])
+
+
+class IncrementalKnapsackTest(unittest.TestCase):
+    def test_value_holds_full_row(self):
+        # 15 slots per run, but a full row of 101 cells after many runs
+        n_items, weight_bound, value_bound = 15, 100, 100
+        bit_lengths = knapsack_bit_lengths(n_items, weight_bound, value_bound, incremental=True)
+        self.assertLess((weight_bound + 1) * value_bound, 1 << (bit_lengths["value"] - 1))
+        single_run = knapsack_bit_lengths(n_items, weight_bound, value_bound)
+        self.assertLess(single_run["value"], bit_lengths["value"])
+
+
+if __name__ == "__main__":
+    unittest.main()
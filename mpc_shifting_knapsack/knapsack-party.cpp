@@ -0,0 +1,221 @@
+// MP-SPDZ front end of the shifting knapsack. It runs the algorithm of
+// shifting_knapsack.hpp directly against the C++ protocol interface of
+// MP-SPDZ, without the compiler and the bytecode interpreter. Every row
+// operation is one batched multiplication or opening.
+//
+// It is built inside MP-SPDZ like Utils/paper-example.cpp, by
+//
+//     make -C mpc_shifting_knapsack party
+//
+// which links this file and shifting_knapsack.hpp into MP-SPDZ/Utils and
+// builds MP-SPDZ/knapsack-party.x with the MP-SPDZ Makefile.
+//
+// Usage, from the MP-SPDZ root with one process per party:
+//
+//     ./knapsack-party.x <my number> <number of parties> <protocol> \
+//         <capacity> <tx per party> <weight bound> <value bound> [port base]
+//
+// protocol is one of mascot, shamir, mal-shamir, semi2k and rep-ring.
+// Every party reads a line of tx per party values and a line of weights
+// from Player-Data/Input-P<my number>-0, the files of the experiment
+// harness. The result is printed as a RESULT line like the .mpc programs.
+
+#define NO_MIXED_CIRCUITS
+
+#include "Math/gfp.hpp"
+#include "Machines/SPDZ.hpp"
+#include "Machines/Rep.hpp"
+#include "Machines/ShamirMachine.hpp"
+#include "Machines/Semi2k.hpp"
+#include "Protocols/ProtocolSet.h"
+#include "Tools/time-func.h"
+
+#include "shifting_knapsack.hpp"
+
+#include <fstream>
+
+// Engine of shifting_knapsack.hpp on the shares of protocol T
+template<class T>
+class ProtocolEngine
+{
+    typedef typename T::clear clear;
+
+    Player& P;
+    ProtocolSet<T>& set;
+
+public:
+    typedef T Share;
+
+    ProtocolEngine(Player& P, ProtocolSet<T>& set) :
+            P(P), set(set)
+    {
+    }
+
+    T constant(uint64_t x)
+    {
+        return T::constant(clear(x), P.my_num(), set.output.get_alphai());
+    }
+
+    vector<T> mul(const vector<T>& a, const vector<T>& b)
+    {
+        auto& protocol = set.protocol;
+        protocol.init_mul();
+        for (size_t i = 0; i < a.size(); i++)
+            protocol.prepare_mul(a[i], b[i]);
+        protocol.exchange();
+        vector<T> res(a.size());
+        for (size_t i = 0; i < a.size(); i++)
+            res[i] = protocol.finalize_mul();
+        return res;
+    }
+
+    vector<clear> open(const vector<T>& x)
+    {
+        vector<clear> res;
+        set.output.POpen(res, x, P);
+        return res;
+    }
+
+    vector<vector<T>> bit_decompose(const vector<T>& x, uint64_t n_bits)
+    {
+        // Opens x + r for random bits r and subtracts the low bits of r
+        // from the public result with a ripple borrow, one round per bit.
+        // In a field, r has n_bits plus the statistical security parameter
+        // bits, so that x + r hides x and does not wrap around. In a ring,
+        // r covers the whole ring and the wrap-around does not affect the
+        // low bits.
+        int mask_bits = T::clear::prime_field ?
+                n_bits + OnlineOptions::singleton.security_parameter :
+                T::clear::length();
+
+        vector<vector<T>> r(n_bits, vector<T>(x.size()));
+        vector<T> masked(x);
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            clear power = 1;
+            for (int b = 0; b < mask_bits; b++)
+            {
+                T bit = set.preprocessing.get_bit();
+                if (b < int(n_bits))
+                    r[b][i] = bit;
+                masked[i] += bit * power;
+                power += power;
+            }
+        }
+        auto c = open(masked);
+
+        vector<vector<T>> bits(n_bits, vector<T>(x.size()));
+        vector<T> borrow(x.size(), constant(0));
+        for (uint64_t b = 0; b < n_bits; b++)
+        {
+            vector<T> both = b == 0 ? borrow : mul(r[b], borrow);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                bool c_bit = mpz_tstbit(bigint(c[i]).get_mpz_t(), b);
+                T r_xor_borrow = r[b][i] + borrow[i] - both[i] - both[i];
+                bits[b][i] = c_bit ? constant(1) - r_xor_borrow : r_xor_borrow;
+                borrow[i] = c_bit ? both[i] : r[b][i] + borrow[i] - both[i];
+            }
+        }
+        return bits;
+    }
+};
+
+template<class T>
+void run(char** argv, int prime_length);
+
+int main(int argc, char** argv)
+{
+    if (argc < 8)
+    {
+        cerr << "Usage: " << argv[0]
+                << " <my number> <number of parties> <protocol> <capacity>"
+                << " <tx per party> <weight bound> <value bound> [port base]"
+                << endl;
+        exit(1);
+    }
+
+    string protocol = argv[3];
+    int prime_length = 128;
+
+    if (protocol == "mascot")
+        run<Share<gfp_<0, 2>>>(argv, prime_length);
+    else if (protocol == "semi2k")
+        run<SemiShare<Z2<64>>>(argv, 0);
+    else if (protocol == "rep-ring")
+        run<Rep3Share<Z2<64>>>(argv, 0);
+    else if (protocol == "shamir" or protocol == "mal-shamir")
+    {
+        int nparties = atoi(argv[2]);
+        ShamirOptions::s().threshold = (nparties - 1) / 2;
+        ShamirOptions::s().nparties = nparties;
+        if (protocol == "shamir")
+            run<ShamirShare<gfp_<0, 2>>>(argv, prime_length);
+        else
+            run<MaliciousShamirShare<gfp_<0, 2>>>(argv, prime_length);
+    }
+    else
+    {
+        cerr << "Unknown protocol: " << protocol << endl;
+        exit(1);
+    }
+}
+
+template<class T>
+void run(char** argv, int prime_length)
+{
+    int my_number = atoi(argv[1]);
+    int n_parties = atoi(argv[2]);
+    uint64_t capacity = atoll(argv[4]);
+    uint64_t tx_per_party = atoll(argv[5]);
+    uint64_t weight_bound = atoll(argv[6]);
+    uint64_t value_bound = atoll(argv[7]);
+    int port_base = argv[8] ? atoi(argv[8]) : 14000;
+
+    Names N(my_number, n_parties, "localhost", port_base);
+    CryptoPlayer P(N);
+    ProtocolSetup<T> setup(P, prime_length);
+    ProtocolSet<T> set(P, setup);
+    ProtocolEngine<T> engine(P, set);
+
+    // Values line, then weights line
+    ifstream input_file("Player-Data/Input-P" + to_string(my_number) + "-0");
+    vector<uint64_t> mine(2 * tx_per_party);
+    for (auto& x : mine)
+        input_file >> x;
+    if (not input_file)
+        throw runtime_error("cannot read the input of party " + to_string(my_number));
+
+    auto& input = set.input;
+    input.reset_all(P);
+    for (auto& x : mine)
+        input.add_mine(typename T::clear(x));
+    for (int j = 0; j < n_parties; j++)
+        if (j != my_number)
+            for (size_t k = 0; k < mine.size(); k++)
+                input.add_other(j);
+    input.exchange();
+
+    vector<T> values, weights;
+    for (int j = 0; j < n_parties; j++)
+    {
+        for (uint64_t k = 0; k < tx_per_party; k++)
+            values.push_back(input.finalize(j));
+        for (uint64_t k = 0; k < tx_per_party; k++)
+            weights.push_back(input.finalize(j));
+    }
+
+    Timer timer;
+    timer.start();
+    T result = knapsack_val(engine, weights, values, capacity,
+            weight_bound, value_bound);
+
+    // protocol check before revealing the result
+    set.check();
+    auto opened = engine.open({result});
+    set.check();
+    timer.stop();
+
+    cout << "RESULT knapsack_value " << opened[0] << endl;
+    cerr << "Time = " << timer.elapsed() << " seconds" << endl;
+}
@@ -0,0 +1,3 @@
+# Read by the MP-SPDZ Makefile after its own rules: knapsack-party.x needs
+# the same objects as paper-example.x
+knapsack-party.x: $(VM) $(OT) $(FHEOFFLINE)
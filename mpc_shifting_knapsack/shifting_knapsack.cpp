@@ -1,95 +1,20 @@
 // This implementation was done by Afonso Tinoco from Carnegie Mellon University
 
 
-#include <cmath>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <vector>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
+#include "shifting_knapsack.hpp"
 
-void CMOV(bool enabled, uint64_t& dst, uint64_t& src) {
-    if (enabled) {
-        dst = src;
-    }
-}
-
-template<typename T>
-void CXCHG(bool enabled, T& src, T& dst) {
-    if (enabled) {
-        T aux = src;
-        src = dst;
-        dst = aux;
-    }
-}
-
-template<typename T>
-void maybeShiftByK(
-    bool enabled, // data oblivious
-    std::vector<T>& vals, // data oblivious, public length 
-    uint64_t K, // public
-    uint64_t i, // first index, public
-    uint64_t j // last index + 1, public
-)
-{
-    std::cout << vals.size() << " " << i << " " << j << std::endl;
-
-    uint64_t N = j-i;
-
-    K=K%N;
-    if (K == 0) return;
-
-    for(uint64_t l=0; l<(N-K); l++) {
-        CXCHG<T>(enabled, vals[i + ((l+K)%N)], vals[i+l]);
-    }
-
-    // Last K elements are shifted inside by (-K)%N:
-    //
-    uint64_t K2 = (K - (N % K)) % K;
-
-    if (K2 != 0) {
-        maybeShiftByK(enabled, vals, K2, j-K, j);
-    }
-}
-
-template<typename T>
-void maybeShiftByK(
-    bool enabled, // data oblivious
-    std::vector<T>& vals, // data oblivious, public length 
-    uint64_t K // public
-)
-{
-    maybeShiftByK(enabled, vals, K, 0, vals.size());
-}
-
-template<typename T>
-void cyclicShift(
-    std::vector<T>& vals, // data oblivious, public length 
-    uint64_t K,           // oblivious 
-    uint64_t maxLogK      // public 
-)
-{
-    // Applies oblivious cyclic shift on an array of vals by ammount K, leaking maxlogK
-    //
-    while (maxLogK != 0) {
-        maxLogK--;
-        bool shouldMov = (K & (1ULL<<maxLogK)) != 0;
-        maybeShiftByK(shouldMov, vals, 1<<maxLogK);
-        uint64_t sK = K^(1ULL<<maxLogK);
-        CMOV(shouldMov, K, sK);
-    }
-}
-
-template <typename S>
-std::ostream& operator<<(std::ostream& os,
-                    const std::vector<S>& vector)
-{
-    // Printing all the elements
-    // using <<
-    for (auto element : vector) {
-        os << element << " ";
-    }
-    return os;
-}
 
 template<bool Oblivious>
 uint64_t knapsack_val(
@@ -101,37 +26,14 @@ uint64_t knapsack_val(
 {
     uint64_t N = weights.size();
     if constexpr (Oblivious) {
-        // UNDONE(): Prove we can remove the outer +1:
-        //
-        uint64_t lwC =std::ceil(std::log2(C+1))+1;
-        uint64_t ret = 0;
-        std::vector<std::vector<uint64_t> > dp;
-        dp.push_back(std::vector<uint64_t>());
-        dp.push_back(std::vector<uint64_t>());
-        for (uint64_t i=0; i<=C; i++) {
-            dp[0].push_back(0);
-            dp[1].push_back(0);
-        }
-
+        // Same operations as the MPC front end, on plain integers
+        PlainEngine engine;
+        uint64_t weightBound = 0, valueBound = 0;
         for (uint64_t i=0; i<N; i++) {
-             for (uint64_t j=0; j<=C; j++) {
-                dp[i%2][j] = dp[(i+1)%2][j];
-            }
-            cyclicShift(dp[(i+1)%2], C+1-weights[i], lwC);
-            for (uint64_t j=0; j<=C; j++) {
-                uint64_t opt2 = dp[(i+1)%2][j] + values[i];
-                bool shouldMov = (j >= weights[i]) * (opt2 > dp[i%2][j]);
-                CMOV(shouldMov, dp[i%2][j], opt2);
-            }
-            bool increased = dp[i%2][C] > ret;
-            CMOV(increased, ret, dp[i%2][C]);
-
-            std::cout << dp << std::endl;
-            // We need this if we want to recover the knapsack items:
-            // cyclicShift(dp[(i+1)%2], weights[i], lwC);
-            //
+            weightBound = std::max(weightBound, weights[i]);
+            valueBound = std::max(valueBound, values[i]);
         }
-        return ret;
+        return knapsack_val(engine, weights, values, C, weightBound, valueBound);
     } else {
         std::vector<uint64_t> dp;
         for (uint64_t i=0; i<=C; i++) {
@@ -148,15 +50,152 @@ uint64_t knapsack_val(
 }
 
 
+// First count numbers of a line, which must be there and be non-negative
+std::vector<uint64_t> parseNumbers(const std::string& line, uint64_t count, const std::string& what)
+{
+    std::vector<uint64_t> numbers;
+    const char* rest = line.c_str();
+    for (uint64_t i=0; i<count; i++) {
+        while (std::isspace(static_cast<unsigned char>(*rest))) {
+            rest++;
+        }
+        char* end;
+        errno = 0;
+        uint64_t number = std::strtoull(rest, &end, 10);
+        if (!std::isdigit(static_cast<unsigned char>(*rest)) || end == rest || errno == ERANGE) {
+            throw std::runtime_error(
+                "expected " + std::to_string(count) + " " + what + ", cannot read number "
+                + std::to_string(i+1) + " of \"" + line + "\""
+            );
+        }
+        numbers.push_back(number);
+        rest = end;
+    }
+    return numbers;
+}
+
+// A command line argument that is a non-negative number and nothing else
+uint64_t parseArgument(const std::string& argument, const std::string& what)
+{
+    if (argument.empty() || argument.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::runtime_error(what + " must be a non-negative number, not \"" + argument + "\"");
+    }
+    try {
+        return parseNumbers(argument, 1, what)[0];
+    } catch (const std::runtime_error&) {
+        // Only digits, so the number did not fit
+        throw std::runtime_error(what + " is out of range: " + argument);
+    }
+}
+
+// Items of one instance from the input files of the experiment harness.
+// The file of every party holds a line of values and a line of weights per
+// instance, padded to the same length; only the first count entries of the
+// party are items.
+void readInstance(
+    std::vector<std::ifstream>& files,
+    const std::vector<uint64_t>& counts,
+    std::vector<uint64_t>& weights,
+    std::vector<uint64_t>& values
+)
+{
+    weights.clear();
+    values.clear();
+    for (uint64_t p=0; p<files.size(); p++) {
+        std::string valuesLine, weightsLine;
+        std::getline(files[p], valuesLine);
+        std::getline(files[p], weightsLine);
+        if (!files[p] && counts[p] > 0) {
+            throw std::runtime_error("missing instance in the input of party " + std::to_string(p));
+        }
+
+        std::string party = " of party " + std::to_string(p);
+        auto partyValues = parseNumbers(valuesLine, counts[p], "values" + party);
+        auto partyWeights = parseNumbers(weightsLine, counts[p], "weights" + party);
+        values.insert(values.end(), partyValues.begin(), partyValues.end());
+        weights.insert(weights.end(), partyWeights.begin(), partyWeights.end());
+    }
+}
+
+
+// Usage:
+//
+//     ./shifting_knapsack <plain|oblivious> <capacity> <instances> <input prefix>
+//         <tx count of party 0> ... <tx count of party n-1>
+//
+// Reads <input prefix>-P<i>-0 for every party, for example
+// MP-SPDZ/Player-Data/Input, and prints the optimal value of every instance
+// as a RESULT line like the .mpc programs, and the time of the computation
+// like MP-SPDZ. Without arguments it solves a built-in example.
 int main(int argc, char const *argv[])
 {
-    std::vector<uint64_t> weights {2415, 2829, 2633, 2982, 2351};
-    std::vector<uint64_t> values {2470, 2895, 1718, 321, 2595};
-    uint64_t W = 10;
-    uint64_t C = 3000;
+    if (argc == 1) {
+        std::vector<uint64_t> weights {2415, 2829, 2633, 2982, 2351};
+        std::vector<uint64_t> values {2470, 2895, 1718, 321, 2595};
+        uint64_t W = 10;
+        uint64_t C = 3000;
+
+        auto result = knapsack_val<true>(weights, values, C, W);
+
+        std::cout << "Result: " << result << std::endl;
+        return 0;
+    }
 
-    auto result = knapsack_val<true>(weights, values, C, W);
+    if (argc < 6 || (std::strcmp(argv[1], "plain") && std::strcmp(argv[1], "oblivious"))) {
+        std::cerr << "Usage: " << argv[0] << " <plain|oblivious> <capacity> <instances>"
+                  << " <input prefix> <tx count of party 0> ..." << std::endl;
+        return 1;
+    }
+
+    bool oblivious = !std::strcmp(argv[1], "oblivious");
+    uint64_t C, instances;
+    std::vector<uint64_t> counts;
+    try {
+        C = parseArgument(argv[2], "capacity");
+        instances = parseArgument(argv[3], "instances");
+        for (int i=5; i<argc; i++) {
+            counts.push_back(parseArgument(argv[i], "tx count of party " + std::to_string(i-5)));
+        }
+    } catch (const std::runtime_error& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
 
-    std::cout << "Result: " << result << std::endl;
+    std::string inputPrefix = argv[4];
+    std::vector<std::ifstream> files;
+    for (int i=5; i<argc; i++) {
+        std::string path = inputPrefix + "-P" + std::to_string(i-5) + "-0";
+        files.emplace_back(path);
+        if (!files.back()) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<uint64_t> results;
+    std::vector<uint64_t> weights, values;
+    std::chrono::duration<double> elapsed(0);
+    for (uint64_t instance=0; instance<instances; instance++) {
+        try {
+            readInstance(files, counts, weights, values);
+        } catch (const std::runtime_error& error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (oblivious) {
+            results.push_back(knapsack_val<true>(weights, values, C, 0));
+        } else {
+            results.push_back(knapsack_val<false>(weights, values, C, 0));
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    std::cout << "RESULT knapsack_value";
+    for (auto result : results) {
+        std::cout << " " << result;
+    }
+    std::cout << std::endl;
+    std::cerr << "Time = " << elapsed.count() << " seconds" << std::endl;
     return 0;
 }
@@ -0,0 +1,191 @@
+// Shifting knapsack over an arithmetic engine. shifting_knapsack.cpp runs
+// it on plain integers; an engine on secret shares runs the same code.
+//
+// The engine provides the secret operations on whole rows, so that one
+// exchange serves every cell of the DP row:
+//
+//   typename Engine::Share           secret value, supports + and -
+//   Share constant(uint64_t x)       public x as a share
+//   std::vector<Share> mul(a, b)     elementwise products
+//   std::vector<std::vector<Share>> bit_decompose(x, n_bits)
+//                                    bits 0..n_bits-1 of every x[i], which
+//                                    must be in [0, 2^n_bits)
+
+#ifndef SHIFTING_KNAPSACK_HPP_
+#define SHIFTING_KNAPSACK_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+// Bit length of a comparison between integers in [0, bound], one more than
+// the bits of bound for the sign of the difference (mpc_common/bit_lengths.py)
+inline uint64_t comparisonBitLength(uint64_t bound)
+{
+    uint64_t bits = 1;
+    while (bound >> bits) {
+        bits++;
+    }
+    return bits + 1;
+}
+
+template<typename Engine>
+std::vector<typename Engine::Share> ifElse(
+    Engine& engine,
+    const std::vector<typename Engine::Share>& condition,
+    const std::vector<typename Engine::Share>& a,
+    const std::vector<typename Engine::Share>& b
+)
+{
+    std::vector<typename Engine::Share> diff(a.size());
+    for (uint64_t i=0; i<a.size(); i++) {
+        diff[i] = a[i] - b[i];
+    }
+    auto res = engine.mul(condition, diff);
+    for (uint64_t i=0; i<a.size(); i++) {
+        res[i] = res[i] + b[i];
+    }
+    return res;
+}
+
+template<typename Engine>
+std::vector<typename Engine::Share> lessEqual(
+    Engine& engine,
+    const std::vector<typename Engine::Share>& x, // values in [0, 2^(bitLength-1))
+    const std::vector<typename Engine::Share>& y, // same length and range
+    uint64_t bitLength                            // public
+)
+{
+    // y - x + 2^(bitLength-1) has its top bit set iff x <= y
+    std::vector<typename Engine::Share> diff(x.size());
+    auto offset = engine.constant(1ULL << (bitLength-1));
+    for (uint64_t i=0; i<x.size(); i++) {
+        diff[i] = y[i] - x[i] + offset;
+    }
+    return engine.bit_decompose(diff, bitLength)[bitLength-1];
+}
+
+template<typename Engine>
+void cyclicShift(
+    Engine& engine,
+    std::vector<typename Engine::Share>& vals, // data oblivious, public length
+    typename Engine::Share K,                  // oblivious
+    uint64_t maxLogK                           // public
+)
+{
+    // Rotates vals to the left by K, so that vals[j] afterwards holds the
+    // former vals[(j+K) % N]. Each bit of K selects between the row and its
+    // rotation by a public power of two, one multiplication per bit.
+    uint64_t N = vals.size();
+    auto bits = engine.bit_decompose({K}, maxLogK);
+
+    for (uint64_t b=0; b<maxLogK; b++) {
+        uint64_t shift = (1ULL << b) % N;
+        if (shift == 0) {
+            continue;
+        }
+        std::vector<typename Engine::Share> rotated(N);
+        for (uint64_t j=0; j<N; j++) {
+            rotated[j] = vals[(j+shift) % N];
+        }
+        std::vector<typename Engine::Share> shouldMov(N, bits[b][0]);
+        vals = ifElse(engine, shouldMov, rotated, vals);
+    }
+}
+
+template<typename Engine>
+typename Engine::Share knapsack_val(
+    Engine& engine,
+    const std::vector<typename Engine::Share>& weights, // data oblivious, public length
+    const std::vector<typename Engine::Share>& values,  // data oblivious, public length
+    uint64_t C,                                         // public
+    uint64_t weightBound,                               // public, bound on a single weight
+    uint64_t valueBound                                 // public, bound on a single value
+)
+{
+    typedef typename Engine::Share Share;
+
+    uint64_t N = weights.size();
+
+    // An item heavier than C+1 never fits, just like one of weight C+1, and
+    // C+1 keeps the shift C+1-weight in [0, C]. Clamping all weights to it
+    // takes one decomposition.
+    std::vector<Share> capacity(N, engine.constant(C+1));
+    auto light = lessEqual(
+        engine, weights, capacity, comparisonBitLength(std::max(weightBound, C+1))
+    );
+    auto clamped = ifElse(engine, light, weights, capacity);
+
+    uint64_t lwC = comparisonBitLength(C+1) - 1;
+    // Items weigh at least 1, so a DP cell sums at most C+1 values
+    uint64_t bitLength = std::max(
+        comparisonBitLength(C+1),
+        comparisonBitLength(std::min(N, C+1) * valueBound)
+    );
+
+    std::vector<Share> cells(C+1);
+    for (uint64_t j=0; j<=C; j++) {
+        cells[j] = engine.constant(j);
+    }
+    std::vector<Share> dp(C+1, engine.constant(0));
+
+    for (uint64_t i=0; i<N; i++) {
+        std::vector<Share> shifted = dp;
+        cyclicShift(engine, shifted, engine.constant(C+1) - clamped[i], lwC);
+
+        // Both comparisons of the row go into one decomposition:
+        // clamped[i] <= j and dp[j] <= opt2[j]
+        std::vector<Share> lhs(2*(C+1)), rhs(2*(C+1));
+        for (uint64_t j=0; j<=C; j++) {
+            lhs[j] = clamped[i];
+            rhs[j] = cells[j];
+            lhs[C+1+j] = dp[j];
+            rhs[C+1+j] = shifted[j] + values[i];
+        }
+        auto le = lessEqual(engine, lhs, rhs, bitLength);
+
+        std::vector<Share> fits(le.begin(), le.begin()+C+1);
+        std::vector<Share> better(le.begin()+C+1, le.end());
+        auto shouldMov = engine.mul(fits, better);
+        dp = ifElse(engine, shouldMov, std::vector<Share>(rhs.begin()+C+1, rhs.end()), dp);
+    }
+
+    // Rows only grow with every item, so the last one holds the maximum
+    return dp[C];
+}
+
+// Engine on plain integers. It executes the same operations as a secret
+// engine, so the running time of the oblivious algorithm does not depend
+// on the data.
+struct PlainEngine
+{
+    typedef uint64_t Share;
+
+    Share constant(uint64_t x)
+    {
+        return x;
+    }
+
+    std::vector<Share> mul(const std::vector<Share>& a, const std::vector<Share>& b)
+    {
+        std::vector<Share> res(a.size());
+        for (uint64_t i=0; i<a.size(); i++) {
+            res[i] = a[i] * b[i];
+        }
+        return res;
+    }
+
+    std::vector<std::vector<Share> > bit_decompose(const std::vector<Share>& x, uint64_t nBits)
+    {
+        std::vector<std::vector<Share> > bits(nBits, std::vector<Share>(x.size()));
+        for (uint64_t b=0; b<nBits; b++) {
+            for (uint64_t i=0; i<x.size(); i++) {
+                bits[b][i] = (x[i] >> b) & 1;
+            }
+        }
+        return bits;
+    }
+};
+
+#endif
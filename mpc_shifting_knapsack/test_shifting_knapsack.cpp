@@ -0,0 +1,83 @@
+// Checks the oblivious shifting knapsack of shifting_knapsack.hpp against
+// the textbook DP on random instances, including items heavier than the
+// capacity. Run with `make test`.
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "shifting_knapsack.hpp"
+
+
+uint64_t knapsackDP(
+    const std::vector<uint64_t>& weights,
+    const std::vector<uint64_t>& values,
+    uint64_t C
+)
+{
+    std::vector<uint64_t> dp(C+1, 0);
+    for (uint64_t i=0; i<weights.size(); i++) {
+        for (uint64_t j=C+1; j-- > weights[i] && weights[i] <= C;) {
+            dp[j] = std::max(dp[j], dp[j-weights[i]] + values[i]);
+        }
+    }
+    return dp[C];
+}
+
+bool check(
+    const std::vector<uint64_t>& weights,
+    const std::vector<uint64_t>& values,
+    uint64_t C,
+    uint64_t weightBound,
+    uint64_t valueBound
+)
+{
+    PlainEngine engine;
+    uint64_t oblivious = knapsack_val(engine, weights, values, C, weightBound, valueBound);
+    uint64_t expected = knapsackDP(weights, values, C);
+    if (oblivious == expected) {
+        return true;
+    }
+
+    std::cerr << "C=" << C << " weights";
+    for (auto w : weights) {
+        std::cerr << " " << w;
+    }
+    std::cerr << " values";
+    for (auto v : values) {
+        std::cerr << " " << v;
+    }
+    std::cerr << ": oblivious " << oblivious << ", expected " << expected << std::endl;
+    return false;
+}
+
+int main()
+{
+    int failures = 0;
+
+    // A single item that is heavier than the capacity plus one
+    failures += !check({7}, {1}, 1, 7, 1);
+
+    std::mt19937_64 random(1);
+    for (int t=0; t<500; t++) {
+        uint64_t C = 1 + random() % 40;
+        uint64_t N = random() % 8;
+        // Up to three times the capacity, so that many items never fit
+        uint64_t weightBound = 3 * (C+1);
+        uint64_t valueBound = 1 + random() % 50;
+        std::vector<uint64_t> weights(N), values(N);
+        for (uint64_t i=0; i<N; i++) {
+            weights[i] = 1 + random() % weightBound;
+            values[i] = random() % (valueBound+1);
+        }
+        failures += !check(weights, values, C, weightBound, valueBound);
+    }
+
+    if (failures) {
+        std::cerr << failures << " instances failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All instances passed" << std::endl;
+    return 0;
+}